@@ -0,0 +1,135 @@
+/*! \file bench_logistic.cpp
+* \brief Microbenchmark of the logistic reaction norms
+*
+* Compares the batched evaluation (gather + logistic) with one
+* scalar std::exp per individual, as Patch::create_offsprings did
+* before, and the batch in math=fast. Checks that they agree.
+* Usage: bench_logistic [auto|default|avx2|avx512]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <cmath>
+#include <string>
+#include "isa.h"
+#include "cmd_line.h"
+#include "logistic.h"
+
+
+namespace npm {
+
+  rnd_engine thread_local RndEng = rndutils::make_random_engine<rnd_engine>();
+
+}
+
+
+using namespace npm;
+
+
+namespace {
+
+  // reference: one exp per individual
+  void scalar_logistic(IndividualStore const& store, handle_t const* h, size_t N, double n, double* out)
+  {
+    for (size_t j = 0; j < N; ++j)
+    {
+      const double R = static_cast<double>(j + 1);
+      out[j] = 1.0 / (1.0 + std::exp(store.phen<A0>(h[j]) + n * store.phen<A1>(h[j]) + R * store.phen<A2>(h[j])));
+    }
+  }
+
+
+  void batch_logistic(IndividualStore const& store, handle_t const* h, size_t N, double n, Math math, logistic_batch& batch, double* out)
+  {
+    batch.gather<A0, A1, A2>(store, N, [h](size_t j) { return h[j]; }, [](size_t j) { return j + 1; });
+    logistic(batch, n, math, out);
+  }
+
+}
+
+
+int main(int argc, const char* argv[])
+{
+  // optional argument: kernel variant
+  try
+  {
+    std::string isa = (argc > 1) ? argv[1] : "auto";
+    select_isa(isa == "auto" ? detect_isa() : static_cast<Isa>(cmd::check_any(isa, isa_name, "invalid kernel variant")));
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << "bench_logistic: " << e.what() << '\n';
+    return -1;
+  }
+  std::cout << "kernel variant: " << isa_name[kernel_isa()] << '\n';
+  const size_t sizes[] = { 1, 2, 5, 10, 20, 50, 100, 200 };
+  const size_t individuals = 1 << 16;
+  std::mt19937_64 reng(42);
+  std::normal_distribution<double> allele(0.0, 1.0);
+  IndividualStore store;
+  store.resize(individuals);
+  Parameter param;
+  for (size_t i = 0; i < individuals; ++i)
+  {
+    Individual ind(param);
+    for (auto& a : ind.phen) a = static_cast<allele_t>(allele(reng));
+    store.set(static_cast<handle_t>(i), ind);
+  }
+  // breeders are scattered over the store
+  std::vector<handle_t> handles(individuals);
+  for (size_t i = 0; i < individuals; ++i) handles[i] = static_cast<handle_t>(i);
+  std::shuffle(handles.begin(), handles.end(), reng);
+
+  std::cout << "    n   scalar [ns]   batch [ns]    fast [ns]\n";
+  logistic_batch batch;
+  std::vector<double> a(256), b(256), c(256);
+  for (auto N : sizes)
+  {
+    const size_t groups = individuals / N;
+    const size_t reps = std::max<size_t>(4000000 / N, groups);
+    for (size_t g = 0; g < groups; ++g)
+    { // same probabilities
+      scalar_logistic(store, handles.data() + g * N, N, double(N), a.data());
+      batch_logistic(store, handles.data() + g * N, N, double(N), MATH_EXACT, batch, b.data());
+      batch_logistic(store, handles.data() + g * N, N, double(N), MATH_FAST, batch, c.data());
+      for (size_t j = 0; j < N; ++j)
+      {
+        if (std::abs(a[j] - b[j]) > 1e-12) throw std::logic_error("logistic: different probabilities");
+        if (std::abs(a[j] - c[j]) > 1e-8) throw std::logic_error("logistic: fast math out of budget");
+      }
+    }
+    double sink = 0.0;
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (size_t r = 0; r < reps; ++r)
+    {
+      scalar_logistic(store, handles.data() + (r % groups) * N, N, double(N), a.data());
+      sink += a[0];
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (size_t r = 0; r < reps; ++r)
+    {
+      batch_logistic(store, handles.data() + (r % groups) * N, N, double(N), MATH_EXACT, batch, b.data());
+      sink += b[0];
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    for (size_t r = 0; r < reps; ++r)
+    {
+      batch_logistic(store, handles.data() + (r % groups) * N, N, double(N), MATH_FAST, batch, c.data());
+      sink += c[0];
+    }
+    auto t3 = std::chrono::high_resolution_clock::now();
+    const double tscalar = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    const double tbatch = std::chrono::duration<double, std::nano>(t2 - t1).count();
+    const double tfast = std::chrono::duration<double, std::nano>(t3 - t2).count();
+    std::cout << std::setw(5) << N
+              << std::fixed << std::setprecision(1)
+              << std::setw(14) << tscalar / reps << std::setw(13) << tbatch / reps << std::setw(13) << tfast / reps
+              << (sink == 0.0 ? " " : "") << '\n';
+  }
+  return 0;
+}
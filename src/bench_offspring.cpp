@@ -0,0 +1,85 @@
+/*! \file bench_offspring.cpp
+* \brief Microbenchmark of the offspring kernel
+*
+* Time per offspring of IndividualStore::create_offspring across
+* batch sizes and mutation rates.
+* Usage: bench_offspring [auto|default|avx2|avx512]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <string>
+#include "isa.h"
+#include "cmd_line.h"
+#include "individual_store.h"
+
+
+namespace npm {
+
+  rnd_engine thread_local RndEng = rndutils::make_random_engine<rnd_engine>();
+
+}
+
+
+using namespace npm;
+
+
+int main(int argc, const char* argv[])
+{
+  // optional argument: kernel variant
+  try
+  {
+    std::string isa = (argc > 1) ? argv[1] : "auto";
+    select_isa(isa == "auto" ? detect_isa() : static_cast<Isa>(cmd::check_any(isa, isa_name, "invalid kernel variant")));
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << "bench_offspring: " << e.what() << '\n';
+    return -1;
+  }
+  std::cout << "kernel variant: " << isa_name[kernel_isa()] << '\n';
+  const size_t batches[] = { 1, 2, 5, 10, 20, 50, 100 };
+  const double mus[] = { 0.001, 0.01, 0.1 };
+  const size_t offspring = 1 << 16;
+  const size_t breeders = 16;
+  Parameter param;
+  IndividualStore store(param);
+  store.resize(offspring + breeders + 1);
+  std::vector<handle_t> h(offspring), breeder(breeders);
+  std::vector<unsigned> R(offspring);
+  for (size_t j = 0; j < offspring; ++j)
+  {
+    h[j] = static_cast<handle_t>(j);
+    R[j] = static_cast<unsigned>(1 + j % breeders);
+  }
+  for (size_t i = 0; i < breeders; ++i) breeder[i] = static_cast<handle_t>(offspring + i);
+  const auto male = static_cast<handle_t>(offspring + breeders);
+
+  std::cout << "batch";
+  for (auto mu : mus) std::cout << "  mu=" << std::setw(5) << mu << " [ns]";
+  std::cout << '\n';
+  for (auto n : batches)
+  {
+    std::cout << std::setw(5) << n;
+    for (auto mu : mus)
+    {
+      param.mu = mu;
+      const size_t reps = 20;
+      auto t0 = std::chrono::high_resolution_clock::now();
+      for (size_t r = 0; r < reps; ++r)
+      {
+        for (size_t j = 0; j + n <= offspring; j += n)
+        {
+          store.create_offspring(h.data() + j, R.data() + j, n, breeder.data(), male, param);
+        }
+      }
+      auto t1 = std::chrono::high_resolution_clock::now();
+      std::cout << std::fixed << std::setprecision(1) << std::setw(16)
+                << std::chrono::duration<double, std::nano>(t1 - t0).count() / static_cast<double>(reps * (offspring - offspring % n));
+    }
+    std::cout << '\n';
+  }
+  return 0;
+}
@@ -0,0 +1,111 @@
+/*! \file bench_placement.cpp
+* \brief Microbenchmark of the OPLACEMENT_SORT placement
+*
+* Compares merge_daughters with inserting the daughters one after
+* the other, as Patch::do_dispersal<OPLACEMENT_SORT> did before.
+* Checks that both produce the same hierarchy.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include "patch.h"
+
+
+namespace npm {
+
+  rnd_engine thread_local RndEng = rndutils::make_random_engine<rnd_engine>();
+
+}
+
+
+using namespace npm;
+
+
+namespace {
+
+  // reference: one insertion per daughter
+  void insert_daughters(std::vector<handle_t>& breeder, handle_t const* daughter, unsigned const* R, size_t k)
+  {
+    size_t rank_shift = 0;
+    for (size_t i = 0; i < k; ++i)
+    {
+      breeder.insert(breeder.begin() + (R[i] + rank_shift++), daughter[i]);
+    }
+  }
+
+
+  // a group of n breeders with k daughters
+  struct group
+  {
+    std::vector<handle_t> breeder;
+    std::vector<handle_t> daughter;
+    std::vector<unsigned> R;
+  };
+
+
+  group make_group(size_t n, size_t k, std::mt19937_64& reng)
+  {
+    group g;
+    for (size_t i = 0; i < n; ++i) g.breeder.push_back(static_cast<handle_t>(i));
+    std::uniform_int_distribution<unsigned> rank(1, static_cast<unsigned>(n));
+    for (size_t i = 0; i < k; ++i) g.R.push_back(rank(reng));
+    std::sort(g.R.begin(), g.R.end());
+    for (size_t i = 0; i < k; ++i) g.daughter.push_back(static_cast<handle_t>(n + i));
+    return g;
+  }
+
+}
+
+
+int main()
+{
+  const size_t sizes[] = { 1, 2, 5, 10, 20, 50, 100, 200 };
+  const size_t groups = 1000;
+  std::mt19937_64 reng(42);
+  std::cout << "    n      k   insert [ns]   merge [ns]\n";
+  for (auto n : sizes)
+  {
+    const size_t k = std::max<size_t>(n / 2, 1);   // F0 = 1, half of the offspring stay
+    std::vector<group> G;
+    for (size_t i = 0; i < groups; ++i) G.push_back(make_group(n, k, reng));
+    const size_t reps = std::max<size_t>(2000000 / (n + k), groups);
+    std::vector<handle_t> a, b;
+    std::vector<unsigned> shift(n);
+    for (auto const& g : G)
+    { // same hierarchy
+      a = g.breeder;
+      insert_daughters(a, g.daughter.data(), g.R.data(), k);
+      b = g.breeder;
+      b.resize(n + k);
+      merge_daughters(b.data(), n, g.daughter.data(), g.R.data(), k, shift.data());
+      if (a != b) throw std::logic_error("merge_daughters: different hierarchy");
+    }
+    // both timings include copying the group
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (size_t r = 0; r < reps; ++r)
+    {
+      auto const& g = G[r % groups];
+      a.assign(g.breeder.begin(), g.breeder.end());
+      insert_daughters(a, g.daughter.data(), g.R.data(), k);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (size_t r = 0; r < reps; ++r)
+    {
+      auto const& g = G[r % groups];
+      std::copy(g.breeder.begin(), g.breeder.end(), b.begin());
+      merge_daughters(b.data(), n, g.daughter.data(), g.R.data(), k, shift.data());
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    const double tinsert = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    const double tmerge = std::chrono::duration<double, std::nano>(t2 - t1).count();
+    std::cout << std::setw(5) << n << std::setw(7) << k
+              << std::fixed << std::setprecision(1)
+              << std::setw(13) << tinsert / reps << std::setw(13) << tmerge / reps << '\n';
+  }
+  return 0;
+}
@@ -0,0 +1,81 @@
+/*! \file bench_rng.cpp
+* \brief Microbenchmark of the random number engines
+*
+* Draws per second of rndutils::xorshift128, the previous RndEng,
+* rndutils::xorshift1024 and block_engine, raw and through the
+* Bernoulli and uniform helpers, local and thread_local.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "npm.h"
+#include "sampling.h"
+
+
+namespace npm {
+
+  rnd_engine thread_local RndEng = rndutils::make_random_engine<rnd_engine>();
+
+}
+
+
+using namespace npm;
+
+
+namespace {
+
+  rndutils::xorshift128 thread_local tls_xorshift128 = rndutils::make_random_engine<rndutils::xorshift128>();
+
+  constexpr size_t draws = 1 << 26;
+
+
+  // f() performs 'per' draws
+  template <typename F>
+  void report(const char* name, F f, size_t per = 1)
+  {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    uint64_t sink = 0;
+    for (size_t i = 0; i < draws / per; ++i) sink += f();
+    auto t1 = std::chrono::high_resolution_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / draws;
+    std::cout << std::setw(44) << std::left << name << std::right
+              << std::fixed << std::setprecision(2) << std::setw(8) << ns
+              << std::setw(10) << std::setprecision(0) << 1000.0 / ns
+              << (sink == 1 ? " " : "") << '\n';
+  }
+
+}
+
+
+int main()
+{
+  std::cout << std::setw(44) << std::left << "draw" << std::right << "  [ns]  [M/s]\n";
+  auto x128 = rndutils::make_random_engine<rndutils::xorshift128>();
+  auto x1024 = rndutils::make_random_engine<rndutils::xorshift1024>();
+  auto block = rndutils::make_random_engine<rnd_engine>();
+  report("xorshift128 word", [&]() { return x128(); });
+  report("xorshift1024 word", [&]() { return x1024(); });
+  report("block_engine word", [&]() { return block(); });
+  report("thread_local xorshift128 word", []() { return tls_xorshift128(); });
+  report("thread_local block_engine word", []() { return RndEng(); });
+
+  const double p = 0.3;
+  report("xorshift128 std::bernoulli_distribution", [&]() { return std::bernoulli_distribution(p)(x128); });
+  report("block_engine std::bernoulli_distribution", [&]() { return std::bernoulli_distribution(p)(block); });
+  const auto thr = rndutils::bernoulli_threshold(p);
+  report("xorshift128 bernoulli_trial", [&]() { return rndutils::bernoulli_trial(x128, thr); });
+  report("block_engine bernoulli_trial", [&]() { return rndutils::bernoulli_trial(block, thr); });
+  std::vector<uint64_t> thresholds(256, thr);
+  std::vector<char> trials(256);
+  report("block_engine generate_bernoulli_n", [&]() {
+    rndutils::generate_bernoulli_n(trials.size(), thresholds.data(), block, trials.data());
+    return trials[0];
+  }, trials.size());
+  report("xorshift128 generate_canonical", [&]() { return uint64_t(1e6 * std::generate_canonical<double, 64>(x128)); });
+  report("block_engine uniform53", [&]() { return uint64_t(1e6 * uniform53(block)); });
+  return 0;
+}
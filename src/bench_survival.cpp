@@ -0,0 +1,110 @@
+/*! \file bench_survival.cpp
+* \brief Microbenchmark of the mortality sweep
+*
+* Compares survival_sweep with one Bernoulli trial per individual,
+* as do_mortality and Population::do_floater_survival did before.
+* Counts the calls into the random number engine and checks that
+* both keep the expected fraction of survivors.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <cmath>
+#include "individual_store.h"
+#include "survival.h"
+
+
+namespace npm {
+
+  rnd_engine thread_local RndEng = rndutils::make_random_engine<rnd_engine>();
+
+}
+
+
+using namespace npm;
+
+
+namespace {
+
+  // engine that counts its calls
+  struct counting_engine
+  {
+    using result_type = rnd_engine::result_type;
+    static constexpr result_type min() { return rnd_engine::min(); }
+    static constexpr result_type max() { return rnd_engine::max(); }
+    result_type operator()() { ++calls; return reng(); }
+
+    rnd_engine& reng;
+    size_t calls = 0;
+  };
+
+
+  // reference: one Bernoulli trial per individual
+  template <typename URNG>
+  size_t bernoulli_survival(std::vector<handle_t>& v, double pDeath, URNG& reng)
+  {
+    std::bernoulli_distribution bernoulli(pDeath);
+    v.erase(std::remove_if(v.begin(), v.end(), [&](handle_t) { return bernoulli(reng); }), v.end());
+    return v.size();
+  }
+
+
+  template <typename URNG>
+  size_t sweep_survival(std::vector<handle_t>& v, double pDeath, URNG& reng)
+  {
+    v.erase(survival_sweep(v.begin(), v.end(), pDeath, [](handle_t) { return false; }, reng), v.end());
+    return v.size();
+  }
+
+}
+
+
+int main()
+{
+  const size_t individuals = 1 << 18;
+  const size_t reps = 200;
+  std::vector<handle_t> pool(individuals), v;
+  for (size_t i = 0; i < individuals; ++i) pool[i] = static_cast<handle_t>(i);
+
+  std::cout << " pDeath   bernoulli [ns]  calls   sweep [ns]  calls   survivors   expected\n";
+  for (double pDeath : { 0.05, 0.2, 0.4, 0.6, 0.95 })
+  {
+    counting_engine ce{ RndEng };
+    double survivors = 0.0;
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (size_t r = 0; r < reps; ++r)
+    {
+      v = pool;
+      bernoulli_survival(v, pDeath, ce);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    const size_t bcalls = ce.calls;
+    ce.calls = 0;
+    for (size_t r = 0; r < reps; ++r)
+    {
+      v = pool;
+      survivors += static_cast<double>(sweep_survival(v, pDeath, ce));
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    const double n = static_cast<double>(reps * individuals);
+    const double expected = (1.0 - pDeath) * n;
+    if (std::abs(survivors - expected) > 5.0 * std::sqrt(n * pDeath * (1.0 - pDeath)))
+    {
+      throw std::logic_error("survival_sweep: unexpected number of survivors");
+    }
+    std::cout << std::fixed << std::setw(7) << std::setprecision(2) << pDeath
+              << std::setprecision(2)
+              << std::setw(17) << std::chrono::duration<double, std::nano>(t1 - t0).count() / n
+              << std::setw(7) << bcalls / n
+              << std::setw(13) << std::chrono::duration<double, std::nano>(t2 - t1).count() / n
+              << std::setw(7) << ce.calls / n
+              << std::setw(12) << std::setprecision(4) << survivors / n
+              << std::setw(11) << 1.0 - pDeath << '\n';
+  }
+  return 0;
+}
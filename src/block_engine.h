@@ -0,0 +1,144 @@
+/*! \file block_engine.h
+* \brief Block-buffered random number engine with SIMD lanes
+*
+*/
+
+#ifndef NPM_BLOCK_ENGINE_H_INCLUDED
+#define NPM_BLOCK_ENGINE_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <algorithm>
+#include <limits>
+#include <random>
+
+
+namespace npm {
+
+
+  //! \brief Block-buffered xorshift128+ with independent lanes
+  //! \tparam LANES number of independent xorshift128+ generators
+  //! \tparam ROUNDS steps per lane and refill
+  //!
+  //! The lanes step together in one vectorized loop and fill a block
+  //! of LANES * ROUNDS words. operator() hands out the block word by
+  //! word, the refill is out of line. Same interface as
+  //! rndutils::xorshift128, thus a drop-in engine for the standard
+  //! distributions. The stream differs from rndutils::xorshift128.
+  template <size_t LANES = 8, size_t ROUNDS = 4>
+  class block_engine
+  {
+  public:
+    using result_type = uint64_t;
+    using engine_type = block_engine;
+
+    static constexpr size_t block_size = LANES * ROUNDS;
+    static constexpr uint64_t default_seed = static_cast<uint64_t>(0xccf05c43b8137c1f);
+    static constexpr uint64_t (min)() { return 0ull; };
+    static constexpr uint64_t (max)() { return std::numeric_limits<uint64_t>::max(); };
+
+    explicit block_engine(uint64_t val = default_seed)
+    {
+      seed(val);
+    }
+
+    explicit block_engine(std::seed_seq& sseq)
+    {
+      seed(sseq);
+    }
+
+    void seed(uint64_t val = default_seed)
+    {
+      std::seed_seq sseq{val};
+      seed(sseq);
+    }
+
+    void seed(std::seed_seq& sseq)
+    {
+      std::array<uint32_t, 4> s;
+      sseq.generate(s.begin(), s.end());
+      seed((static_cast<uint64_t>(s[1]) << 32u) | s[0], (static_cast<uint64_t>(s[3]) << 32u) | s[2]);
+    }
+
+    //! \brief Sets the lanes from a 128 bit seed
+    //!
+    //! The lanes are splitmix64 sequences of both halves, cheap
+    //! enough for short-lived streams derived from a counter-based
+    //! generator, e.g. one stream per task.
+    void seed(uint64_t s0, uint64_t s1) noexcept
+    {
+      for (size_t l = 0; l < LANES; ++l)
+      {
+        s0_[l] = splitmix64(s0);
+        s1_[l] = splitmix64(s1) ^ s0_[l];
+        if ((s0_[l] | s1_[l]) == 0) s0_[l] = default_seed;   // all-zero state is invalid
+      }
+      pos_ = block_size;
+    }
+
+    uint64_t operator()(void) noexcept
+    {
+      if (pos_ == block_size) refill();
+      return block_[pos_++];
+    }
+
+    void discard(unsigned long long z) noexcept
+    {
+      for (unsigned long long i = 0; i < z; ++i) this->operator()();
+    }
+
+    friend bool operator==(engine_type const& lhs, engine_type const& rhs) noexcept
+    {
+      return lhs.s0_ == rhs.s0_ && lhs.s1_ == rhs.s1_ && lhs.pos_ == rhs.pos_ &&
+             std::equal(lhs.block_.begin() + lhs.pos_, lhs.block_.end(), rhs.block_.begin() + rhs.pos_);
+    }
+
+    friend bool operator!=(engine_type const& lhs, engine_type const& rhs) noexcept
+    {
+      return !(lhs == rhs);
+    }
+
+  private:
+    static uint64_t splitmix64(uint64_t& x) noexcept
+    {
+      uint64_t z = (x += 0x9e3779b97f4a7c15);
+      z = (z ^ (z >> 30u)) * 0xbf58476d1ce4e5b9;
+      z = (z ^ (z >> 27u)) * 0x94d049bb133111eb;
+      return z ^ (z >> 31u);
+    }
+
+#if defined(__GNUC__)
+    __attribute__((noinline))
+#endif
+    void refill() noexcept
+    {
+      for (size_t r = 0; r < ROUNDS; ++r)
+      {
+        uint64_t* __restrict out = block_.data() + r * LANES;
+#pragma omp simd
+        for (size_t l = 0; l < LANES; ++l)
+        {
+          uint64_t x = s0_[l];
+          const uint64_t y = s1_[l];
+          s0_[l] = y;
+          x ^= x << 23u;
+          x ^= x >> 17u;
+          x ^= y ^ (y >> 26u);
+          s1_[l] = x;
+          out[l] = x + y;
+        }
+      }
+      pos_ = 0;
+    }
+
+    alignas(64) std::array<uint64_t, block_size> block_;
+    alignas(64) std::array<uint64_t, LANES> s0_;
+    alignas(64) std::array<uint64_t, LANES> s1_;
+    size_t pos_ = block_size;
+  };
+
+
+}
+
+#endif
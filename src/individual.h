@@ -14,7 +14,9 @@ namespace npm {
 
   //! \brief An individual
   //!
-  //! An Individual is not much more than a bag of its alleles
+  //! An Individual is not much more than a bag of its alleles.
+  //! The population keeps its individuals in an IndividualStore,
+  //! Individual is the value type to get them in and out of there.
   struct Individual
   {
     // \brief default copy constructor and assignment operator are fine
@@ -27,19 +29,10 @@ namespace npm {
     //! \brief creates individual with initial alleles
     explicit Individual(Parameter const& param);
 
-    //! \brief Creates an offspring
-    //! \param param the parameter set
-    //! \param female Female ancestor
-    //! \param male male ancestor
-    //! \param mRank mothers rank
-    //!
-    //! Mutation and recombination happens here
-    Individual(Parameter const& param, Individual const& female, Individual const& male, unsigned mRank);
-
     Alleles phen;						            //!< active 'phenotype'
     std::array<Alleles, 2> inherited;   //!< inherited alleles [mother, father]
-    unsigned age;                       //!< age of this individual
-    unsigned mRank;                     //!< mothers rank
+    age_t age;                          //!< age of this individual
+    rank_t mRank;                       //!< mothers rank
   };
 
 
@@ -0,0 +1,213 @@
+/*! \file individual_store.cpp
+* \brief Definition of the structure-of-arrays storage of the individuals
+*/
+
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include "rndutils.hpp"
+#include "isa.h"
+#include "individual_store.h"
+#include "sampling.h"
+
+
+namespace npm {
+
+
+  void IndividualStore::resize(size_t n)
+  {
+    for (auto& col : phen_) col.resize(n);
+    inherited_.resize(n);
+    age_.resize(n, age_t(0));
+    mRank_.resize(n);
+  }
+
+
+  handle_t IndividualStore::push_back(Individual const& ind)
+  {
+    auto h = static_cast<handle_t>(size());
+    resize(size() + 1);
+    set(h, ind);
+    return h;
+  }
+
+
+  Alleles IndividualStore::phen(handle_t h) const
+  {
+    Alleles phen;
+    for (size_t i = 0; i < Loci::MAX_ALLELE; ++i) phen[i] = phen_[i][h];
+    return phen;
+  }
+
+
+  Individual IndividualStore::get(handle_t h) const
+  {
+    Individual ind;
+    ind.phen = phen(h);
+    ind.inherited = inherited_[h];
+    ind.age = age_[h];
+    ind.mRank = mRank_[h];
+    return ind;
+  }
+
+
+  void IndividualStore::set(handle_t h, Individual const& ind)
+  {
+    for (size_t i = 0; i < Loci::MAX_ALLELE; ++i) phen_[i][h] = ind.phen[i];
+    inherited_[h] = ind.inherited;
+    age_[h] = ind.age;
+    mRank_[h] = ind.mRank;
+  }
+
+
+  IndividualStore::IndividualStore(Parameter const& param)
+  {
+    for (size_t i = 0; i < Loci::MAX_ALLELE; ++i)
+    {
+      if (param.mask[i] == allele_t(0)) active_ &= ~(1u << i);
+    }
+  }
+
+
+  // Offspring kernel for the active loci \p active, either a
+  // compile-time std::integral_constant or a run-time bit set.
+  // Masked loci neither recombine nor mutate, they are zero.
+  template <typename Active>
+  NPM_KERNEL_INLINE void IndividualStore::breed(Active active, handle_t const* h, unsigned const* R, size_t n, handle_t const* breeder, handle_t male, Parameter const& param)
+  {
+    auto& reng = RndEng;
+    unsigned loci[MAX_ALLELE];
+    size_t na = 0;
+    for (unsigned i = 0; i < MAX_ALLELE; ++i)
+    {
+      if ((active >> i) & 1u) loci[na++] = i;
+    }
+    // Recombination - one bit per locus, ten offspring per engine word
+    constexpr unsigned per_word = 64 / MAX_ALLELE;
+    auto const& father = inherited_[male];
+    uint64_t recomb = 0;
+    for (size_t j = 0; j < n; ++j)
+    {
+      if (na && (j % per_word == 0)) recomb = static_cast<uint64_t>(reng());
+      auto const& mother = inherited_[breeder[R[j] - 1]];
+      auto& inherited = inherited_[h[j]];
+      for (unsigned i = 0; i < MAX_ALLELE; ++i)
+      {
+        if ((active >> i) & 1u)
+        {
+          const size_t r = (recomb >> i) & 1;
+          inherited[0][i] = mother[r][i];
+          inherited[1][i] = father[r][i];
+        }
+        else
+        {
+          inherited[0][i] = inherited[1][i] = phen_[i][h[j]] = allele_t(0);
+        }
+      }
+      recomb >>= MAX_ALLELE;
+    }
+    // Mutation - geometric gaps over the 2 * na * n active alleles
+    const size_t alleles = 2 * na * n;
+    if (param.mu > 0.0 && alleles)
+    {
+      const mutation_dist rndMut(0.0, param.gamma);
+      const geometric_gap gap_dist(param.mu < 1.0 ? param.mu : 0.5);
+      size_t gap[sample_batch];
+      double dev[sample_batch];
+      size_t s = 0;
+      while (s < alleles)
+      {
+        // the next batch of mutated alleles, sized to the expected number
+        const double expected = param.mu * static_cast<double>(alleles - s);
+        const size_t m = std::min(sample_batch, static_cast<size_t>(expected) + 1);
+        if (param.mu < 1.0) gap_dist(reng, gap, m); else std::fill_n(gap, m, size_t(0));
+        draw_deviates(rndMut, reng, dev, m);
+        for (size_t k = 0; k < m && (s += gap[k]) < alleles; ++k, ++s)
+        {
+          const size_t j = s / (2 * na);
+          const size_t a = s % (2 * na);
+          inherited_[h[j]][a / na][loci[a % na]] += static_cast<allele_t>(dev[k]);
+        }
+      }
+    }
+    // optional: scale the inherited alleles
+    for (size_t j = 0; j < n; ++j)
+    {
+      auto& inherited = inherited_[h[j]];
+      for (unsigned i = 0; i < MAX_ALLELE; ++i)
+      {
+        if ((active >> i) & 1u)
+        {
+          const auto x = inherited[0][i];
+          const auto y = inherited[1][i];
+          inherited[0][i] = param.mask[i] * x;
+          inherited[1][i] = param.mask[i] * y;
+          phen_[i][h[j]] = allele_t(0.5) * (x + y);
+        }
+      }
+    }
+  }
+
+
+  // picks the kernel instance for the active loci
+  NPM_KERNEL_INLINE void IndividualStore::breed_active(handle_t const* h, unsigned const* R, size_t n, handle_t const* breeder, handle_t male, Parameter const& param)
+  {
+    constexpr unsigned all = all_loci;
+    constexpr unsigned no_R = all_loci & ~((1u << A2) | (1u << B2));
+    switch (active_)
+    {
+      case all: breed(std::integral_constant<unsigned, all>(), h, R, n, breeder, male, param); break;
+      case no_R: breed(std::integral_constant<unsigned, no_R>(), h, R, n, breeder, male, param); break;
+      default: breed(active_, h, R, n, breeder, male, param); break;
+    }
+  }
+
+
+  template <>
+  void IndividualStore::breed_isa<Isa::ISA_DEFAULT>(handle_t const* h, unsigned const* R, size_t n, handle_t const* breeder, handle_t male, Parameter const& param)
+  {
+    breed_active(h, R, n, breeder, male, param);
+  }
+
+
+  template <>
+  NPM_TARGET_AVX2 void IndividualStore::breed_isa<Isa::ISA_AVX2>(handle_t const* h, unsigned const* R, size_t n, handle_t const* breeder, handle_t male, Parameter const& param)
+  {
+    breed_active(h, R, n, breeder, male, param);
+  }
+
+
+  template <>
+  NPM_TARGET_AVX512 void IndividualStore::breed_isa<Isa::ISA_AVX512>(handle_t const* h, unsigned const* R, size_t n, handle_t const* breeder, handle_t male, Parameter const& param)
+  {
+    breed_active(h, R, n, breeder, male, param);
+  }
+
+
+  // kernel variants, indexed by Isa
+  void (IndividualStore::* const IndividualStore::breed_isa_pmf[Isa::ISA_MAX])(handle_t const*, unsigned const*, size_t, handle_t const*, handle_t, Parameter const&) = {
+    &IndividualStore::breed_isa<Isa::ISA_DEFAULT>,
+    &IndividualStore::breed_isa<Isa::ISA_AVX2>,
+    &IndividualStore::breed_isa<Isa::ISA_AVX512>
+  };
+
+
+  void IndividualStore::create_offspring(handle_t const* h, unsigned const* R, size_t n, handle_t const* breeder, handle_t male, Parameter const& param)
+  {
+    for (size_t j = 0; j < n; ++j)
+    {
+      age_[h[j]] = 0;
+      mRank_[h[j]] = static_cast<rank_t>(R[j]);
+    }
+    (this->*breed_isa_pmf[kernel_isa()])(h, R, n, breeder, male, param);
+  }
+
+
+  void IndividualStore::increment_age()
+  {
+    constexpr age_t max_age = std::numeric_limits<age_t>::max();
+    for (auto& a : age_) a += (a != max_age);
+  }
+
+
+}
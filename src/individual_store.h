@@ -0,0 +1,161 @@
+/*! \file individual_store.h
+* \brief Structure-of-arrays storage of the individuals in the natal philopatry model
+*
+*/
+
+#ifndef NPM_INDIVIDUAL_STORE_H_INCLUDED
+#define NPM_INDIVIDUAL_STORE_H_INCLUDED
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+#include <memory>
+#include <utility>
+#include "individual.h"
+#include "isa.h"
+
+
+namespace npm {
+
+
+  //! \brief Handle of an individual in the IndividualStore
+  using handle_t = uint32_t;
+
+
+  //! \brief The invalid handle
+  constexpr handle_t no_handle = static_cast<handle_t>(-1);
+
+
+  //! \brief A range of reserved slots in the IndividualStore
+  //!
+  //! Blocks are reserved up front, thus several threads can
+  //! create individuals concurrently, each one in its own block.
+  struct StoreBlock
+  {
+    handle_t const* next;   //!< next unused slot
+    handle_t const* end;    //!< end of the block
+
+    //! Returns next unused slot
+    handle_t allocate()
+    {
+      assert(next < end);
+      return *next++;
+    }
+  };
+
+
+  //! \brief Allocator that default-initializes instead of value-initializes
+  //!
+  //! Growing the store doesn't zero slots that are overwritten anyway.
+  template <typename T>
+  struct default_init_allocator : std::allocator<T>
+  {
+    template <typename U> struct rebind { using other = default_init_allocator<U>; };
+
+    default_init_allocator() = default;
+    template <typename U> default_init_allocator(default_init_allocator<U> const&) noexcept {}
+
+    template <typename U> void construct(U* p) noexcept { ::new(static_cast<void*>(p)) U; }
+    template <typename U, typename... Args> void construct(U* p, Args&&... args)
+    {
+      ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+  };
+
+
+  //! \brief Structure-of-arrays storage of the individuals
+  //!
+  //! Every locus of the phenotype, the age and the mothers rank live in
+  //! their own contiguous arrays. Only the inherited alleles are kept
+  //! together per individual, offspring creation reads all of them
+  //! from two randomly placed parents.
+  //! Individuals are referred to by handle, i.e. by index into these arrays.
+  //! Moving an individual between patches and floater pools moves its handle.
+  //! The store doesn't know which slots are alive, the owner of the handles
+  //! keeps track of the free slots.
+  class IndividualStore
+  {
+  public:
+    //! \brief creates an empty store, all loci active
+    IndividualStore() = default;
+
+    //! \brief creates an empty store
+    //! \param param the parameter set, loci with zero mask are inactive
+    explicit IndividualStore(Parameter const& param);
+
+    //! Returns number of slots, dead or alive
+    size_t size() const { return age_.size(); }
+
+    //! \brief Resizes the store
+    //! \param n new number of slots
+    void resize(size_t n);
+
+    //! \brief Appends an individual
+    //! \param ind the individual
+    //! \returns handle of the new slot
+    handle_t push_back(Individual const& ind);
+
+    //! Returns locus \p L of the phenotype
+    template <Loci L> allele_t phen(handle_t h) const { return phen_[L][h]; }
+
+    //! Returns the phenotype
+    Alleles phen(handle_t h) const;
+
+    //! Returns the inherited alleles [mother, father]
+    std::array<Alleles, 2> const& inherited(handle_t h) const { return inherited_[h]; }
+
+    //! Returns the age
+    age_t age(handle_t h) const { return age_[h]; }
+
+    //! Returns the mothers rank
+    rank_t mRank(handle_t h) const { return mRank_[h]; }
+
+    //! \brief Returns a copy of the individual
+    Individual get(handle_t h) const;
+
+    //! \brief Overwrites the individual in slot \p h
+    void set(handle_t h, Individual const& ind);
+
+    //! \brief Creates a batch of offspring of one male
+    //! \param h the slots h[0..n), usually from a StoreBlock
+    //! \param R mothers rank, offspring h[j] descends from breeder[R[j] - 1]
+    //! \param n number of offspring
+    //! \param breeder the breeders of the patch
+    //! \param male male ancestor
+    //! \param param the parameter set
+    //!
+    //! Mutation and recombination happens here. One engine word
+    //! recombines ten offspring, the mutated alleles are picked by
+    //! geometric skipping over the whole batch. Inactive loci
+    //! are zero and draw no random numbers. The common patterns of
+    //! active loci are unrolled at compile time. Runs the kernel
+    //! variant selected by select_isa.
+    void create_offspring(handle_t const* h, unsigned const* R, size_t n, handle_t const* breeder, handle_t male, Parameter const& param);
+
+    //! \brief Increments the age of all slots, dead or alive
+    //!
+    //! The age saturates at the maximum of age_t.
+    void increment_age();
+
+  private:
+    static constexpr unsigned all_loci = (1u << MAX_ALLELE) - 1;
+
+    template <typename Active>
+    void breed(Active active, handle_t const* h, unsigned const* R, size_t n, handle_t const* breeder, handle_t male, Parameter const& param);
+    void breed_active(handle_t const* h, unsigned const* R, size_t n, handle_t const* breeder, handle_t male, Parameter const& param);
+    template <Isa ISA> void breed_isa(handle_t const* h, unsigned const* R, size_t n, handle_t const* breeder, handle_t male, Parameter const& param);
+    static void (IndividualStore::* const breed_isa_pmf[Isa::ISA_MAX])(handle_t const*, unsigned const*, size_t, handle_t const*, handle_t, Parameter const&);
+
+    template <typename T> using column = std::vector<T, default_init_allocator<T>>;
+
+    std::array<column<allele_t>, MAX_ALLELE> phen_;
+    column<std::array<Alleles, 2>> inherited_;
+    column<age_t> age_;
+    column<rank_t> mRank_;
+    unsigned active_ = all_loci;        // bit set of the loci with non-zero mask
+  };
+
+
+}
+
+#endif
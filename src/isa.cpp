@@ -0,0 +1,42 @@
+/*! \file isa.cpp
+* \brief Definition of the run-time selection of the kernel instruction set
+*/
+
+#include <stdexcept>
+#include <string>
+#include "isa.h"
+
+
+namespace npm {
+
+
+  const char* isa_name[Isa::ISA_MAX] = { "default", "avx2", "avx512" };
+
+
+  namespace detail {
+    Isa selected_isa = Isa::ISA_DEFAULT;
+  }
+
+
+  Isa detect_isa()
+  {
+#ifdef NPM_ISA_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("x86-64-v4")) return Isa::ISA_AVX512;
+    if (__builtin_cpu_supports("x86-64-v3")) return Isa::ISA_AVX2;
+#endif
+    return Isa::ISA_DEFAULT;
+  }
+
+
+  void select_isa(Isa isa)
+  {
+    if (isa > detect_isa())
+    {
+      throw std::runtime_error(std::string("Kernel variant ") + isa_name[isa] + " not supported by this CPU");
+    }
+    detail::selected_isa = isa;
+  }
+
+
+}
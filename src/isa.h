@@ -0,0 +1,64 @@
+/*! \file isa.h
+* \brief Run-time selection of the instruction set of the numeric kernels
+*
+* The hot kernels are compiled for several instruction sets, one
+* binary runs on old and new nodes alike. The variant is picked
+* once at startup, see select_isa.
+*/
+
+#ifndef NPM_ISA_H_INCLUDED
+#define NPM_ISA_H_INCLUDED
+
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define NPM_ISA_DISPATCH
+#  define NPM_TARGET_AVX2 __attribute__((target("arch=x86-64-v3")))
+#  define NPM_TARGET_AVX512 __attribute__((target("arch=x86-64-v4")))
+#  define NPM_KERNEL_INLINE __attribute__((always_inline)) inline
+#else
+#  define NPM_TARGET_AVX2
+#  define NPM_TARGET_AVX512
+#  define NPM_KERNEL_INLINE inline
+#endif
+
+
+namespace npm {
+
+
+  //! \brief instruction set variants of the kernels
+  enum Isa
+  {
+    ISA_DEFAULT,          //!< baseline of the build
+    ISA_AVX2,             //!< x86-64-v3: AVX2, FMA
+    ISA_AVX512,           //!< x86-64-v4: AVX-512
+    ISA_MAX
+  };
+
+
+  extern const char* isa_name[Isa::ISA_MAX];
+
+
+  namespace detail {
+    extern Isa selected_isa;
+  }
+
+
+  //! \brief Returns the best variant the CPU supports
+  Isa detect_isa();
+
+
+  //! \brief Selects the kernel variant
+  //! \param isa the variant, must be supported by the CPU
+  //!
+  //! Not thread safe, call before any simulation runs.
+  //! Defaults to ISA_DEFAULT.
+  void select_isa(Isa isa);
+
+
+  //! \brief Returns the selected kernel variant
+  inline Isa kernel_isa() { return detail::selected_isa; }
+
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+/*! \file logistic.cpp
+* \brief Definition of the batched logistic reaction norms
+*/
+
+#include <cmath>
+#include "isa.h"
+#include "logistic.h"
+#include "math_mode.h"
+
+
+namespace npm {
+
+
+  namespace {
+
+    template <Math M>
+    NPM_KERNEL_INLINE void logistic_kernel(logistic_batch const& batch, double n, double* out)
+    {
+      const size_t N = batch.size();
+      double const* __restrict c0 = batch.c0.data();
+      double const* __restrict c1 = batch.c1.data();
+      double const* __restrict c2 = batch.c2.data();
+      double const* __restrict R = batch.R.data();
+      double* __restrict p = out;
+#pragma omp simd
+      for (size_t i = 0; i < N; ++i)
+      {
+        p[i] = 1.0 / (1.0 + math_exp<M>(c0[i] + n * c1[i] + R[i] * c2[i]));
+      }
+    }
+
+
+    template <Math M>
+    void logistic_default(logistic_batch const& batch, double n, double* out)
+    {
+      logistic_kernel<M>(batch, n, out);
+    }
+
+
+    template <Math M>
+    NPM_TARGET_AVX2 void logistic_avx2(logistic_batch const& batch, double n, double* out)
+    {
+      logistic_kernel<M>(batch, n, out);
+    }
+
+
+    template <Math M>
+    NPM_TARGET_AVX512 void logistic_avx512(logistic_batch const& batch, double n, double* out)
+    {
+      logistic_kernel<M>(batch, n, out);
+    }
+
+
+    // kernel variants, indexed by Isa and Math
+    void (* const logistic_isa[Isa::ISA_MAX][Math::MATH_MAX])(logistic_batch const&, double, double*) = {
+      { &logistic_default<Math::MATH_EXACT>, &logistic_default<Math::MATH_FAST> },
+      { &logistic_avx2<Math::MATH_EXACT>, &logistic_avx2<Math::MATH_FAST> },
+      { &logistic_avx512<Math::MATH_EXACT>, &logistic_avx512<Math::MATH_FAST> }
+    };
+
+  }
+
+
+  void logistic(logistic_batch const& batch, double n, Math math, double* out)
+  {
+    logistic_isa[kernel_isa()][math](batch, n, out);
+  }
+
+
+}
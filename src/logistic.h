@@ -0,0 +1,70 @@
+/*! \file logistic.h
+* \brief Batched logistic reaction norms x(n,R) and y(n,R)
+*
+*/
+
+#ifndef NPM_LOGISTIC_H_INCLUDED
+#define NPM_LOGISTIC_H_INCLUDED
+
+#include <vector>
+#include "individual_store.h"
+
+
+namespace npm {
+
+
+  //! \brief Input of a batch of logistic reaction norms
+  //!
+  //! p = 1 / (1 + exp(c0 + n * c1 + R * c2)) where the coefficients
+  //! c0, c1 and c2 are three loci of the phenotype. The loci are
+  //! gathered from the store into contiguous arrays, thus the
+  //! evaluation runs over plain arrays.
+  struct logistic_batch
+  {
+    std::vector<double> c0;     //!< first locus, e.g. A0
+    std::vector<double> c1;     //!< second locus, e.g. A1
+    std::vector<double> c2;     //!< third locus, e.g. A2
+    std::vector<double> R;      //!< rank
+
+    size_t size() const { return R.size(); }
+
+    //! \brief Gathers the batch
+    //! \tparam L0 locus of c0
+    //! \tparam L1 locus of c1
+    //! \tparam L2 locus of c2
+    //! \param store the individuals
+    //! \param N batch size
+    //! \param h handle of the i-th individual, h(i)
+    //! \param rank rank of the i-th individual, rank(i)
+    template <Loci L0, Loci L1, Loci L2, typename H, typename RANK>
+    void gather(IndividualStore const& store, size_t N, H h, RANK rank)
+    {
+      c0.resize(N);
+      c1.resize(N);
+      c2.resize(N);
+      R.resize(N);
+      for (size_t i = 0; i < N; ++i)
+      {
+        const handle_t x = h(i);
+        c0[i] = store.phen<L0>(x);
+        c1[i] = store.phen<L1>(x);
+        c2[i] = store.phen<L2>(x);
+        R[i] = static_cast<double>(rank(i));
+      }
+    }
+  };
+
+
+  //! \brief Evaluates a batch of logistic reaction norms
+  //! \param batch the gathered input
+  //! \param n group size
+  //! \param math precision of the exponential
+  //! \param out receives batch.size() probabilities
+  //!
+  //! The exponential runs vectorized where the compiler supports it.
+  void logistic(logistic_batch const& batch, double n, Math math, double* out);
+
+
+}
+
+#endif
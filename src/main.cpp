@@ -3,8 +3,12 @@
 */
 
 #include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cmath>
 #include "cmd_line.h"
 #include "npm.h"      // include our model stuff
+#include "isa.h"
 
 
 const char* NPMHelp = R"(Usage: npm [OPTION]... [OPTIONAL PARAMETER]... PARAMETER...
@@ -20,6 +24,10 @@ Options:
   -oxy             prints average x y first offspring
   -oto             prints number of takeover attempts, takeovers and walk-ins
   -aloglast        log alleles only for the last time-step
+  -vcol            compares takeover rates of the colonization engine
+                   with the serial engine
+  -prof            prints run time per console log and, with threads,
+                   steals and load imbalance per tick
 
 Optional parameter as name=value pairs (in brackets the default values):
   m           number of patches (1000)
@@ -45,25 +53,249 @@ Optional parameter as name=value pairs (in brackets the default values):
   ovote       'ignore' or 'account' ('account')
   bvote       one of 'ignore', 'kin', 'despotic', 'egalitarian' 'hierarchical' ('despotic')
   oplacement  offspring hierarchies placement 'back' or 'sort' ('sort')
+  colonization  colonization engine 'serial', 'sharded' or 'sparse' ('serial')
+  math        precision of exp and pow 'exact' or 'fast' ('exact')
   rep         repetitions (1)
   repOfs      start of repetition counter (0)
+  seed        random seed (random)
+  jobs        concurrent repetitions or sweep jobs, 0: all cores (1)
+  sweep       sweep file, see below
   R           invoke R-server with result file (false)
   Rs          start command options ('/B')
   ticks       time ticks to run (1000)
   clog        console log interval (1000)
   precision   precision of allele output (3)
+  threads     threads in the patch loop, 0: classic serial loop (0)
+  isa         kernel variant 'auto', 'default', 'avx2' or 'avx512' ('auto')
 
 Required parameter as name=value pairs:
   mode      mating mode, 'random' or 'residency'
   log       log interval, if 0 only the last state is logged
   file      file name of the result file
 
+Sweep file:
+  Each line holds name=value pairs that override the command line. A value
+  can be a list 'v1,v2,...', a range 'from:to:step' or a quoted string. A
+  line expands into the cartesian product of its values, every line adds
+  its own jobs. The jobs run longest first, 'jobs' at a time. The result
+  files are listed in <file>_manifest.R.
+    eps=0.0001,0.001,0.005 mu=0.001:0.01:0.001
+    mode=residency nmf=0 Mask='1 1 0 1 1 0' tau=2
+
 Examples:
   npm --verbose mode=random nmf=900 log=100 file=res1.R
   npm -v mode=residency nmf=0 eps=0.0001 mu=0.001 gamma=0.01 ticks=1e6 log=10000 file=res2.R
+  npm mode=random nmf=900 log=100 file=sweep.R sweep=sweep.txt jobs=0
 )";
 
 
+//! Parses the parameter set from the command line
+//!
+//! \param clp the command line parser
+//! \returns the parameter set
+npm::Parameter parse_parameter(cmd::cmd_line_parser const& clp)
+{
+  npm::Parameter param;                         // default parameter set
+
+  // Console output flags
+  param.verbose = clp.flag("-v") || clp.flag("--verbose");
+  param.ot = clp.flag("-ot") || param.verbose;
+  param.og = clp.flag("-og") || param.verbose;
+  param.om = clp.flag("-om") || param.verbose;
+  param.off = clp.flag("-off") || param.verbose;
+  param.omf = clp.flag("-omf") || param.verbose;
+  param.oa = clp.flag("-oa") || param.verbose;
+  param.oxy = clp.flag("-oxy") || param.verbose;
+  param.oto = clp.flag("-oto") || param.verbose;
+  param.aloglast = clp.flag("-aloglast") || param.aloglast;
+  param.oprof = clp.flag("-prof");
+  param.vcol = clp.flag("-vcol");
+  param.oany = param.ot || param.og || param.om || param.off || param.omf || param.oa || param.oxy || param.oto || param.oprof;
+
+  param.log = clp.required<size_t>("log");
+  param.offile = clp.required<fs::path>("file");
+  if (param.offile.parent_path().empty()) {
+    param.offile = fs::path(".") / param.offile;
+  }
+  param.nmf = clp.required<size_t>("nmf");
+
+  std::string pstr = clp.required<std::string>("mode");
+  param.mode = (npm::Mating) cmd::check_any(pstr, npm::mating_name, "invalid mode parameter");
+
+  pstr = npm::ovote_name[(int)param.ovote];
+  clp.optional("ovote", pstr);
+  param.ovote = (npm::oVote)cmd::check_any(pstr, npm::ovote_name, "invalid ovote parameter");
+
+  pstr = npm::bvote_name[(int)param.bvote];
+  clp.optional("bvote", pstr);
+  param.bvote = (npm::bVote)cmd::check_any(pstr, npm::bvote_name, "invalid bvote parameter");
+
+  pstr = npm::oplacement_name[(int)param.oplacement];
+  clp.optional("oplacement", pstr);
+  param.oplacement = (npm::oPlacement)cmd::check_any(pstr, npm::oplacement_name, "invalid oplacement parameter");
+
+  pstr = npm::colonization_name[(int)param.colonization];
+  clp.optional("colonization", pstr);
+  param.colonization = (npm::Colonization)cmd::check_any(pstr, npm::colonization_name, "invalid colonization parameter");
+
+  pstr = npm::math_name[(int)param.math];
+  clp.optional("math", pstr);
+  param.math = (npm::Math)cmd::check_any(pstr, npm::math_name, "invalid math parameter");
+
+  clp.optional("m", param.m);
+  clp.optional("m0",param.m0);
+  clp.optional("F0", param.F0);
+  clp.optional("phi", param.phi);
+  clp.optional("delta", param.delta);
+  clp.optional("k", param.k);
+  clp.optional("Alleles", param.alleles);
+  clp.optional("Mask", param.mask);
+  clp.optional("Sb", param.Sb);
+  clp.optional("Sm", param.Sm);
+  clp.optional("Sff", param.Sff);
+  clp.optional("Smf", param.Smf);
+  clp.optional("Smax", param.Smax);
+  clp.optional("sigma", param.sigma);
+  clp.optional("eps", param.eps);
+  clp.optional("t0", param.t0);
+  clp.optional("tau", param.tau);
+  clp.optional("mu", param.mu);
+  clp.optional("gamma", param.gamma);
+  clp.optional("rep", param.rep);
+  clp.optional("repOfs", param.repOfs);
+  param.seed = rndutils::make_random_engine<>()();
+  clp.optional("seed", param.seed);
+  clp.optional("jobs", param.jobs);
+  param.R = clp.flag("-R");
+  clp.optional("Rs", param.Rs);
+  // double? - allow 10^5 etc...
+  double ticks = static_cast<double>(param.ticks);
+  clp.optional("ticks", ticks);
+  param.ticks = static_cast<size_t>(ticks);
+  clp.optional("clog", param.clog);
+  clp.optional("precision", param.precision);
+  clp.optional("threads", param.threads);
+  clp.optional<size_t>("nmf", param.nmf);
+  return param;
+}
+
+
+//! Expands the value specification of a sweep file entry
+//!
+//! \param name the parameter name
+//! \param spec 'v', 'v1,v2,...', 'from:to:step' or a quoted string
+//! \returns the values
+std::vector<std::string> expand_sweep_values(std::string const& name, std::string const& spec)
+{
+  if (spec.size() > 1 && (spec.front() == '\'' || spec.front() == '"') && spec.back() == spec.front())
+  { // verbatim
+    return { spec.substr(1, spec.size() - 2) };
+  }
+  std::vector<std::string> values;
+  std::smatch match;
+  static const std::regex rrange(R"(([^:]+):([^:]+):([^:]+))");
+  if (std::regex_match(spec, match, rrange))
+  { // range
+    double from, to, step;
+    std::istringstream iss(match[1].str() + ' ' + match[2].str() + ' ' + match[3].str());
+    if (!(iss >> from >> to >> step) || !(step > 0.0) || (to < from))
+    {
+      throw cmd::parse_error((std::string("invalid range in sweep entry ") + name).c_str());
+    }
+    auto n = static_cast<size_t>(std::floor((to - from) / step + 1e-9)) + 1;
+    for (size_t i = 0; i < n; ++i)
+    {
+      std::ostringstream oss;
+      oss << std::setprecision(12) << from + static_cast<double>(i) * step;
+      values.push_back(oss.str());
+    }
+    return values;
+  }
+  std::istringstream iss(spec);
+  for (std::string v; std::getline(iss, v, ',');) 
+  { // list
+    if (!v.empty()) values.push_back(v);
+  }
+  if (values.empty())
+  {
+    throw cmd::parse_error((std::string("empty sweep entry ") + name).c_str());
+  }
+  return values;
+}
+
+
+//! Expands the jobs of a sweep file
+//!
+//! \param file the sweep file
+//! \param argc number of command line arguments
+//! \param argv array of command line arguments (C-strings)
+//! \returns the parameter sets of the sweep
+//!
+//! Every line of the sweep file holds name=spec pairs that override the
+//! command line. A line expands into the cartesian product of its specs.
+//! Jobs without explicit file=... are numbered: <file>_<job>.R
+std::vector<npm::SweepJob> expand_sweep(fs::path const& file, int argc, const char* argv[])
+{
+  std::ifstream is(file);
+  if (!is)
+  {
+    throw std::runtime_error((std::string("Can't open sweep file ") + file.string()).c_str());
+  }
+  static const std::regex rentry(R"(([^\s=#]+)=('[^']*'|"[^"]*"|[^\s#]+))");
+  std::vector<npm::SweepJob> jobs;
+  std::string line;
+  while (std::getline(is, line))
+  {
+    line = line.substr(0, line.find('#'));
+    std::vector<std::pair<std::string, std::vector<std::string>>> specs;
+    for (std::sregex_iterator it(line.begin(), line.end(), rentry), last; it != last; ++it)
+    {
+      specs.emplace_back((*it)[1].str(), expand_sweep_values((*it)[1].str(), (*it)[2].str()));
+    }
+    if (specs.empty()) continue;
+    std::vector<size_t> idx(specs.size(), 0);
+    for (;;)
+    {
+      std::vector<std::string> args{ argv[0] };
+      std::string desc;
+      bool named = false;
+      for (size_t k = 0; k < specs.size(); ++k)
+      {
+        args.push_back(specs[k].first + '=' + specs[k].second[idx[k]]);
+        desc += (k ? " " : "") + args.back();
+        named = named || (specs[k].first == "file");
+      }
+      std::vector<std::string> entries(args.cbegin() + 1, args.cend());
+      for (int i = 1; i < argc; ++i) args.emplace_back(argv[i]);
+      cmd::cmd_line_parser clp(args);
+      auto param = parse_parameter(clp);
+      for (auto const& arg : clp.unrecognized())
+      {
+        if (std::find(entries.cbegin(), entries.cend(), arg) != entries.cend())
+        {
+          throw cmd::parse_error((std::string("invalid sweep entry ") + arg).c_str());
+        }
+      }
+      if (!named)
+      { // adjust filename for this job
+        auto ext = param.offile.extension();
+        param.offile.replace_extension();
+        param.offile += "_"; param.offile += std::to_string(jobs.size() + 1); param.offile += ext;
+      }
+      jobs.push_back({ param, desc });
+      size_t k = 0;
+      for (; k < idx.size(); ++k)
+      { // next point in the grid
+        if (++idx[k] < specs[k].second.size()) break;
+        idx[k] = 0;
+      }
+      if (k == idx.size()) break;
+    }
+  }
+  return jobs;
+}
+
+
 //! The (mandatory) function that is called from the OS
 //!
 //! \param argc number of command line arguments
@@ -77,6 +309,7 @@ int main(int argc, const char* argv[])
   if (clp.flag("--help"))
   {
     std::cout << NPMHelp;
+    std::cout << "\nKernel variant on this CPU: " << npm::isa_name[npm::detect_isa()] << '\n';
     return 0;
   }
 
@@ -86,76 +319,20 @@ int main(int argc, const char* argv[])
 
   try
   {
-    npm::Parameter param;                         // default parameter set
-
-    // Console output flags
-    param.verbose = clp.flag("-v") || clp.flag("--verbose");
-    param.ot = clp.flag("-ot") || param.verbose;
-    param.og = clp.flag("-og") || param.verbose;
-    param.om = clp.flag("-om") || param.verbose;
-    param.off = clp.flag("-off") || param.verbose;
-    param.omf = clp.flag("-omf") || param.verbose;
-    param.oa = clp.flag("-oa") || param.verbose;
-    param.oxy = clp.flag("-oxy") || param.verbose;
-    param.oto = clp.flag("-oto") || param.verbose;
-    param.aloglast = clp.flag("-aloglast") || param.aloglast;
-    param.oprof = clp.flag("-prof");
-    param.oany = param.ot || param.og || param.om || param.off || param.omf || param.oa || param.oxy || param.oto || param.oprof;
-
-    param.log = clp.required<size_t>("log");
-    param.offile = clp.required<fs::path>("file");
-    if (param.offile.parent_path().empty()) {
-      param.offile = fs::path(".") / param.offile;
+    auto param = parse_parameter(clp);
+    std::string isa = "auto";
+    clp.optional("isa", isa);
+    npm::select_isa(isa == "auto" ? npm::detect_isa() : (npm::Isa)cmd::check_any(isa, npm::isa_name, "invalid isa parameter"));
+    if (param.verbose) std::cout << "Kernel variant: " << npm::isa_name[npm::kernel_isa()] << '\n';
+    fs::path sweep;
+    if (clp.optional("sweep", sweep))
+    { // parameter sweep
+      npm::RunSweep(expand_sweep(sweep, argc, argv), param);
+    }
+    else
+    { // finally we can start the model...
+      npm::Run(param);
     }
-    param.nmf = clp.required<size_t>("nmf");
-
-    std::string pstr = clp.required<std::string>("mode");
-    param.mode = (npm::Mating) cmd::check_any(pstr, npm::mating_name, "invalid mode parameter");
-
-    pstr = npm::ovote_name[(int)param.ovote];
-    clp.optional("ovote", pstr);
-    param.ovote = (npm::oVote)cmd::check_any(pstr, npm::ovote_name, "invalid ovote parameter");
-
-    pstr = npm::bvote_name[(int)param.bvote];
-    clp.optional("bvote", pstr);
-    param.bvote = (npm::bVote)cmd::check_any(pstr, npm::bvote_name, "invalid bvote parameter");
-
-    pstr = npm::oplacement_name[(int)param.oplacement];
-    clp.optional("oplacement", pstr);
-    param.oplacement = (npm::oPlacement)cmd::check_any(pstr, npm::oplacement_name, "invalid oplacement parameter");
-
-    clp.optional("m", param.m);
-    clp.optional("m0",param.m0);
-    clp.optional("F0", param.F0);
-    clp.optional("phi", param.phi);
-    clp.optional("delta", param.delta);
-    clp.optional("k", param.k);
-    clp.optional("Alleles", param.alleles);
-    clp.optional("Mask", param.mask);
-    clp.optional("Sb", param.Sb);
-    clp.optional("Sm", param.Sm);
-    clp.optional("Sff", param.Sff);
-    clp.optional("Smf", param.Smf);
-    clp.optional("Smax", param.Smax);
-    clp.optional("sigma", param.sigma);
-    clp.optional("eps", param.eps);
-    clp.optional("t0", param.t0);
-    clp.optional("tau", param.tau);
-    clp.optional("mu", param.mu);
-    clp.optional("gamma", param.gamma);
-    clp.optional("rep", param.rep);
-    clp.optional("repOfs", param.repOfs);
-    param.R = clp.flag("-R");
-    clp.optional("Rs", param.Rs);
-    // double? - allow 10^5 etc...
-    double ticks = static_cast<double>(param.ticks);
-    clp.optional("ticks", ticks);
-    param.ticks = static_cast<size_t>(ticks);
-    clp.optional("clog", param.clog);
-    clp.optional("precision", param.precision);
-    clp.optional<size_t>("nmf", param.nmf);
-    // finally we can start the model...
-    npm::Run(param);
     std::cout << "Regards\n";
     return 0;
   }
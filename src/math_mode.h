@@ -0,0 +1,77 @@
+/*! \file math_mode.h
+* \brief exp and pow of the reaction norms in the selected precision
+*
+* MATH_EXACT calls the standard library, MATH_FAST a polynomial
+* approximation that inlines into the vectorized kernels.
+* The target validate_math reports the error budget.
+*/
+
+#ifndef NPM_MATH_MODE_H_INCLUDED
+#define NPM_MATH_MODE_H_INCLUDED
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "isa.h"
+#include "npm.h"
+
+
+namespace npm {
+
+
+  //! \brief Polynomial approximation of exp(x)
+  //!
+  //! exp(x) = 2^k * exp(r) with k = round(x / ln 2) and |r| <= ln 2 / 2,
+  //! exp(r) by its Taylor polynomial of degree 7; 2^k is assembled in
+  //! the exponent bits. Relative error below 1e-8 (7.0e-9 measured by
+  //! math_budget), x is clamped to the range of normal results. Branch free, vectorizes in simd loops.
+  NPM_KERNEL_INLINE double fast_exp(double x)
+  {
+    x = x < -708.0 ? -708.0 : (x > 709.0 ? 709.0 : x);
+    const double t = x * 1.4426950408889634;
+    const int k = static_cast<int>(t + (t < 0.0 ? -0.5 : 0.5));
+    const double r = x - k * 0.6931471805599453;
+    double p = 1.0 / 5040.0;
+    p = p * r + 1.0 / 720.0;
+    p = p * r + 1.0 / 120.0;
+    p = p * r + 1.0 / 24.0;
+    p = p * r + 1.0 / 6.0;
+    p = p * r + 0.5;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+    const int64_t bits = static_cast<int64_t>(k + 1023) << 52;
+    double s;
+    std::memcpy(&s, &bits, sizeof(s));
+    return s * p;
+  }
+
+
+  //! \brief exp(x) in the math mode
+  template <Math M>
+  NPM_KERNEL_INLINE double math_exp(double x)
+  {
+    return (M == Math::MATH_FAST) ? fast_exp(x) : std::exp(x);
+  }
+
+
+  //! \brief exp(x) in the math mode
+  inline double math_exp(double x, Math math)
+  {
+    return (math == Math::MATH_FAST) ? fast_exp(x) : std::exp(x);
+  }
+
+
+  //! \brief Rank^-delta in the math mode
+  //!
+  //! delta == 0 is exact in both modes, MATH_FAST
+  //! evaluates exp(-delta * log(Rank)).
+  inline double rank_power(double Rank, double delta, Math math)
+  {
+    if (delta == 0.0) return 1.0;
+    return (math == Math::MATH_FAST) ? fast_exp(-delta * std::log(Rank)) : std::pow(Rank, -delta);
+  }
+
+
+}
+
+#endif
@@ -7,6 +7,7 @@
 #include <fstream>
 #include <iomanip>
 #include <vector>
+#include <array>
 #include <algorithm>
 #include <utility>
 #include <random>
@@ -14,14 +15,22 @@
 #include <chrono>
 #include <cstdlib>
 #include <regex>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <mutex>
+#include <streambuf>
+#include <string>
 #include "population.h"
 #include "visitors.h"
+#include "thread_pool.h"
+#include "isa.h"
 
 
 namespace npm {
 
 
-  rndutils::xorshift128 thread_local RndEng = rndutils::make_random_engine<>();
+  rnd_engine thread_local RndEng = rndutils::make_random_engine<rnd_engine>();
   
 
   const char* Version = "0.2.1";
@@ -29,6 +38,47 @@ namespace npm {
   const char* oplacement_name[oPlacement::OPLACEMENT_MAX] = { "back", "sort" };
   const char* ovote_name[oVote::OVOTE_MAX] = { "ignore", "account" };
   const char* bvote_name[bVote::BVOTE_MAX] = { "ignore", "kin", "despotic", "egalitarian", "hierarchical" };
+  const char* colonization_name[Colonization::COLONIZATION_MAX] = { "serial", "sharded", "sparse" };
+  const char* math_name[Math::MATH_MAX] = { "exact", "fast" };
+
+
+  namespace {
+
+    std::mutex cout_mutex;
+
+
+    //! \brief Stream buffer for concurrent console output
+    //!
+    //! Collects complete lines and writes them with a prefix
+    //! to std::cout, one line at a time.
+    class line_prefix_buf : public std::streambuf
+    {
+    public:
+      explicit line_prefix_buf(std::string const& prefix) : prefix_(prefix) {}
+      ~line_prefix_buf() { if (!line_.empty()) flush_line(); }
+
+    protected:
+      int_type overflow(int_type ch) override
+      {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+        line_.push_back(traits_type::to_char_type(ch));
+        if (ch == '\n') flush_line();
+        return ch;
+      }
+
+    private:
+      void flush_line()
+      {
+        std::lock_guard<std::mutex> _(cout_mutex);
+        std::cout << prefix_ << line_ << std::flush;
+        line_.clear();
+      }
+
+      std::string prefix_;
+      std::string line_;
+    };
+
+  }
 
 
   //! \brief The Simulation
@@ -36,13 +86,28 @@ namespace npm {
   {
   public:
     //! \brief creates the simulation
-    explicit Simulation(Parameter const& param);
+    //! \param param the parameter set
+    //! \param cout console output stream
+    Simulation(Parameter const& param, std::ostream& cout);
 
-    //! Model loop
-    template <Mating MODE, oPlacement PLACEMENT>
+    //! Model loop, specialized for the policies of the parameter set
+    template <Mating MODE, oPlacement PLACEMENT, oVote OVOTE, bVote BVOTE>
     void run();
 
   private:
+    //! \brief per chunk of patches state of a tick
+    struct tick_buffer
+    {
+      container_t female_floater;   // staged dispersers
+      container_t male_floater;     // staged dispersers
+      patch_scratch scratch;        // reused patch after patch
+      verdict_table verdicts;       // kept for the loggers
+    };
+
+    template <Mating MODE, oPlacement PLACEMENT, oVote OVOTE, bVote BVOTE>
+    void parallel_patch_loop(size_t T);
+    void make_chunks();
+
     void log(size_t T);
     void clog(size_t T);
     std::ostream& stream_R_header(std::ostream& os) const;
@@ -54,6 +119,7 @@ namespace npm {
     std::ostream& stream_mranks(std::ostream& os);
     std::ostream& stream_xynR(std::ostream& os);
     std::ostream& stream_takeover_stats(std::ostream& os);
+    std::ostream& stream_vcol(std::ostream& os);
     Parameter param_;
     Population pop_;
     TakeoverStats takeover_stats_;
@@ -61,16 +127,27 @@ namespace npm {
     TakeoverStats takeover_stats_clog_;
     std::chrono::high_resolution_clock::time_point t0_;
     std::ofstream of_;
+    std::ostream& cout_;
+    std::unique_ptr<thread_pool> pool_;
+    std::vector<tick_buffer> buffers_;
+    std::vector<size_t> chunk_;           // chunk boundaries into pop_.occupied()
+    std::vector<StoreBlock> blocks_;      // offspring slots per chunk
+    steal_stats steal_stats_clog_;        // accumulated since last console log
+    TakeoverStats vcol_serial_;           // serial colonization dry runs
   };
 
 
-  Simulation::Simulation(Parameter const& param)
+  Simulation::Simulation(Parameter const& param, std::ostream& cout)
   : param_(param),
     pop_(param_),
     takeover_stats_{ 0, 0, 0 },
     takeover_stats_log_{ 0, 0, 0 },
-    takeover_stats_clog_{ 0, 0, 0 }
+    takeover_stats_clog_{ 0, 0, 0 },
+    cout_(cout),
+    steal_stats_clog_{ 0, 0.0 },
+    vcol_serial_{ 0, 0, 0 }
   {
+    seed_stream(param_, 0, Stream::STREAM_MASTER);
     // prepare R file
     fs::create_directories(param_.offile.parent_path());
     of_.open(param_.offile, std::fstream::out | std::fstream::trunc);
@@ -81,40 +158,79 @@ namespace npm {
     stream_R_header(of_);
     if (param_.oany)
     {
-      if (param_.ot) std::cout << "'Time' ";
-      if (param_.og) std::cout << "'group-size (f)' ";
-      if (param_.om) std::cout << "'group-size (m)' ";
-      if (param_.off) std::cout << "'floater (f)' ";
-      if (param_.omf) std::cout << "'floater (m)'  ";
-      if (param_.oa) std::cout << "'Alleles' ";
-      if (param_.oxy) std::cout << "'x y' ";
-      if (param_.oto) std::cout << "'takeover' ";
-      std::cout << std::endl;
+      if (param_.ot) cout_ << "'Time' ";
+      if (param_.og) cout_ << "'group-size (f)' ";
+      if (param_.om) cout_ << "'group-size (m)' ";
+      if (param_.off) cout_ << "'floater (f)' ";
+      if (param_.omf) cout_ << "'floater (m)'  ";
+      if (param_.oa) cout_ << "'Alleles' ";
+      if (param_.oxy) cout_ << "'x y' ";
+      if (param_.oto) cout_ << "'takeover' ";
+      cout_ << std::endl;
+    }
+    if (param_.threads || param_.colonization == Colonization::COLONIZATION_SHARDED)
+    {
+      pool_ = std::make_unique<thread_pool>(std::max<size_t>(param_.threads, 1));
     }
     t0_ = std::chrono::high_resolution_clock::now();
   }
 
 
-  template <Mating MODE, oPlacement PLACEMENT>
+  template <Mating MODE, oPlacement PLACEMENT, oVote OVOTE, bVote BVOTE>
   void Simulation::run()
   {
     size_t T = 0;
     for (; T < param_.ticks; ++T)
     {
-      for (auto& patch : pop_.patches())
+      if (param_.threads)
+      {
+        parallel_patch_loop<MODE, PLACEMENT, OVOTE, BVOTE>(T);
+      }
+      else
       {
-        patch.do_reproduction<MODE>(param_, pop_.male_floater());
-        patch.do_dispersal<PLACEMENT>(param_, pop_.female_floater(), pop_.male_floater());
-        patch.do_survival(param_);
+        chunk_.assign({ 0, pop_.occupied().size() });
+        if (buffers_.empty()) buffers_.resize(1);
+        pop_.reserve_offspring(param_, chunk_, blocks_);
+        auto& buf = buffers_[0];
+        buf.verdicts.clear();
+        for (auto i : pop_.occupied())
+        {
+          auto& patch = pop_.patches()[i];
+          patch.do_reproduction<MODE, OVOTE, BVOTE>(param_, pop_.store(), pop_.male_floater(), blocks_[0], buf.scratch);
+          patch.do_dispersal<PLACEMENT, OVOTE, BVOTE>(pop_.female_floater(), pop_.male_floater(), buf.scratch, buf.verdicts, i);
+          patch.do_survival(param_, pop_.store());
+        }
       }
       pop_.shuffle_floater(param_);
       pop_.do_floater_survival(param_);
-      takeover_stats_ += pop_.do_colonization<MODE>(param_);
-      pop_.visit_all([](Individual& ind){ ++ind.age; });
+      if (param_.vcol)
+      { // dry run of the serial engine on its own random stream
+        const auto master = RndEng;
+        seed_stream(param_, T, Stream::STREAM_VCOL);
+        vcol_serial_ += pop_.colonization_stats(param_);
+        RndEng = master;
+      }
+      if (param_.colonization == Colonization::COLONIZATION_SHARDED)
+      {
+        takeover_stats_ += pop_.do_colonization_sharded<MODE>(param_, *pool_, T);
+      }
+      else if (param_.colonization == Colonization::COLONIZATION_SPARSE)
+      {
+        takeover_stats_ += pop_.do_colonization_sparse<MODE>(param_);
+      }
+      else
+      {
+        takeover_stats_ += pop_.do_colonization<MODE>(param_);
+      }
+      pop_.update_occupied();
+      pop_.collect_garbage();
+      pop_.layout_patches(param_);
+      pop_.increment_age();
 
       log(T);
       clog(T);
     }
+    if (param_.vcol) stream_vcol(cout_);
     // Epilogue - append npm.R to result file
     auto cwd = fs::current_path();
     std::ifstream ifs((cwd / "npm.R").c_str());
@@ -122,6 +238,82 @@ namespace npm {
   }
 
 
+  //! Every patch uses its own random stream, keyed by tick and patch index.
+  //! The occupied patches are split into contiguous chunks of similar cost which
+  //! are processed by a work-stealing scheduler.
+  //! Every chunk stages its dispersers in its own tick_buffer, the buffers
+  //! are merged into the floater pools in chunk order afterwards.
+  //! Every chunk creates its offspring in its own block of store slots.
+  //! Together with the per-patch random streams, the outcome is independent 
+  //! of the number of threads. In contrast to the serial loop, random sires
+  //! are drawn from the male floater pool as it was at the start of the tick.
+  template <Mating MODE, oPlacement PLACEMENT, oVote OVOTE, bVote BVOTE>
+  void Simulation::parallel_patch_loop(size_t T)
+  {
+    auto& patches = pop_.patches();
+    auto const& occupied = pop_.occupied();
+    auto const& male_floater = pop_.male_floater();
+    make_chunks();
+    const size_t chunks = chunk_.size() - 1;
+    if (buffers_.size() < chunks) buffers_.resize(chunks);
+    pop_.reserve_offspring(param_, chunk_, blocks_);
+    auto& store = pop_.store();
+    const auto master = RndEng;     // the calling thread takes part
+    auto ss = pool_->parallel_for_stealing(chunks, [&](size_t c)
+    {
+      auto& buf = buffers_[c];
+      buf.female_floater.clear();
+      buf.male_floater.clear();
+      buf.verdicts.clear();
+      for (size_t j = chunk_[c]; j < chunk_[c + 1]; ++j)
+      {
+        const size_t i = occupied[j];
+        seed_stream(param_, T, Stream::STREAM_PATCH | i);
+        auto& patch = patches[i];
+        patch.do_reproduction<MODE, OVOTE, BVOTE>(param_, store, male_floater, blocks_[c], buf.scratch);
+        patch.do_dispersal<PLACEMENT, OVOTE, BVOTE>(buf.female_floater, buf.male_floater, buf.scratch, buf.verdicts, i);
+        patch.do_survival(param_, store);
+      }
+    });
+    RndEng = master;
+    steal_stats_clog_.steals += ss.steals;
+    steal_stats_clog_.imbalance += ss.imbalance;
+    for (size_t c = 0; c < chunks; ++c)
+    {
+      auto const& buf = buffers_[c];
+      pop_.female_floater().insert(pop_.female_floater().end(), buf.female_floater.cbegin(), buf.female_floater.cend());
+      pop_.male_floater().insert(pop_.male_floater().end(), buf.male_floater.cbegin(), buf.male_floater.cend());
+    }
+  }
+
+
+  //! Splits the occupied patches into contiguous chunks of similar estimated cost.
+  //! The cost of a patch is taken as 1 + n * F0, that is the
+  //! number of fecundity trials plus some overhead.
+  void Simulation::make_chunks()
+  {
+    auto const& patches = pop_.patches();
+    auto const& occupied = pop_.occupied();
+    const double F0 = static_cast<double>(std::max<size_t>(param_.F0, 1));
+    double total = 0.0;
+    for (auto i : occupied) total += 1.0 + F0 * patches[i].size();
+    const size_t target_chunks = std::min(occupied.size(), 8 * pool_->num_threads());
+    const double target = total / std::max<size_t>(target_chunks, 1);
+    chunk_.assign(1, 0);
+    double cost = 0.0;
+    for (size_t j = 0; j < occupied.size(); ++j)
+    {
+      cost += 1.0 + F0 * patches[occupied[j]].size();
+      if (cost >= target)
+      {
+        chunk_.push_back(j + 1);
+        cost = 0.0;
+      }
+    }
+    if (chunk_.back() != occupied.size()) chunk_.push_back(occupied.size());
+  }
+
+
   void Simulation::log(size_t T)
   {
     if ((param_.log && (T % param_.log == 0)) || (T == param_.ticks - 1))
@@ -151,22 +343,28 @@ namespace npm {
   {
     if (param_.oany && ((param_.clog && (T % param_.clog == 0)) || (T == param_.ticks - 1)))
     { // print to console
-      auto prec = std::cout.precision();
-      std::cout.precision(4);
-      if (param_.ot) std::cout << T << '\t';
-      stream_mean_groupsize(std::cout) << "  ";
-      if (param_.oa) stream_mean_alleles(std::cout) << "  ";
-      if (param_.oxy) stream_mean_xy(std::cout) << "  ";
+      auto prec = cout_.precision();
+      cout_.precision(4);
+      if (param_.ot) cout_ << T << '\t';
+      stream_mean_groupsize(cout_) << "  ";
+      if (param_.oa) stream_mean_alleles(cout_) << "  ";
+      if (param_.oxy) stream_mean_xy(cout_) << "  ";
       if (param_.oto) 
       { 
         auto t = (takeover_stats_ - takeover_stats_clog_) / param_.clog;
-        std::cout << t.attempt << ' ' << t.takeover << ' ' << t.walkin; 
+        cout_ << t.attempt << ' ' << t.takeover << ' ' << t.walkin; 
       }
       auto t1 = std::chrono::high_resolution_clock::now();
-      if (param_.oprof) std::cout << "\t  " << std::chrono::duration<double>(t1 - t0_).count();
+      if (param_.oprof) cout_ << "\t  " << std::chrono::duration<double>(t1 - t0_).count();
+      if (param_.oprof && pool_)
+      { // scheduler stats per tick
+        auto ticks = static_cast<double>(T ? param_.clog : 1);
+        cout_ << "  " << steal_stats_clog_.steals / ticks << ' ' << steal_stats_clog_.imbalance / ticks;
+        steal_stats_clog_ = { 0, 0.0 };
+      }
       t0_ = t1;
-      std::cout << std::endl;
-      std::cout.precision(prec);
+      cout_ << std::endl;
+      cout_.precision(prec);
       takeover_stats_clog_ = takeover_stats_;
     }
   }
@@ -178,7 +376,8 @@ namespace npm {
     os << "# Version " << Version << '\n';
     os << "path <- '" << fs::absolute(fs::path(param_.offile).remove_filename()).generic_string() << "'\n";
     os << "file <- '" << param_.offile.filename() << "'\n";
-    os << "rep <- " << param_.rep << "\n\n";
+    os << "rep <- " << param_.rep << "\n";
+    os << "seed <- '" << param_.seed << "'\n\n";
     os << "# Parameter set\n";
     os << "m <- " << param_.m << '\n';
     os << "m0 <- " << param_.m0 << '\n';
@@ -206,6 +405,9 @@ namespace npm {
     os << "mu <- " << param_.mu << '\n';
     os << "mudist <- " << (std::is_same<mutation_dist, std::cauchy_distribution<>>::value ? "'cauchy'\n" : "'normal'\n");
     os << "gamma <- " << param_.gamma << '\n';
+    os << "allele_t <- " << (std::is_same<allele_t, float>::value ? "'float'\n" : "'double'\n");
+    os << "isa <- '" << isa_name[kernel_isa()] << "'\n";
+    os << "math <- '" << math_name[(int)param_.math] << "'\n";
     os << "mode <- '" << mating_name[(int)param_.mode] << "'\n";
     os << "ovote <- '" << ovote_name[(int)param_.ovote] << "'\n";
     os << "bvote <- '" << bvote_name[(int)param_.bvote] << "'\n";
@@ -246,20 +448,40 @@ namespace npm {
   std::ostream& Simulation::stream_mean_xy(std::ostream& os)
   {
     mean_behavior_visitor mxyv;
-    pop_.visit_patches(std::ref(mxyv));
+    for (size_t c = 0; c < chunk_.size() - 1; ++c) mxyv(buffers_[c].verdicts, pop_.patches());
     auto mean = mxyv.mean();
     os << mean.x << ' ' << mean.y << ' ';
     return os;
   }
 
 
+  // streams fun(patch) of the occupied patches, '0,' runs for the vacant ones
+  template <typename Fun>
+  void stream_per_patch(std::ostream& os, Population const& pop, Fun fun)
+  {
+    static const std::string zeros = [] { std::string z; for (int i = 0; i < 256; ++i) z += "0,"; return z; }();
+    auto vacant = [&](size_t n)
+    {
+      for (; n > 0; n -= std::min<size_t>(n, 256)) os.write(zeros.data(), 2 * std::min<size_t>(n, 256));
+    };
+    size_t next = 0;
+    for (auto i : pop.occupied())
+    {
+      vacant(i - next);
+      os << fun(pop.patches()[i]) << ',';
+      next = i + 1;
+    }
+    vacant(pop.patches().size() - next);
+  }
+
+
   std::ostream& Simulation::stream_groupsize(std::ostream& os)
   {
     os << "gs[[length(gs)+1]] = c(";
-    for(auto const& patch : pop_.patches()) os << patch.size() << ',';
+    stream_per_patch(os, pop_, [](Patch const& patch) { return patch.size(); });
     os.seekp(-1,std::ios_base::cur) << ")\n";
     os << "males[[length(males)+1]] = c(";
-    for(auto const& patch : pop_.patches()) os << (patch.male() == nullptr ? 0 : 1) << ',';
+    stream_per_patch(os, pop_, [](Patch const& patch) { return patch.has_male() ? 1 : 0; });
     os.seekp(-1,std::ios_base::cur) << ")\n";
     return os;
   }
@@ -269,7 +491,7 @@ namespace npm {
   {
     size_t s = 0;
     size_t m = 0;
-    for (auto const& patch : pop_.patches()) { s += patch.size(); m += (nullptr == patch.male()) ? 0 : 1; }
+    for (auto i : pop_.occupied()) { auto const& patch = pop_.patches()[i]; s += patch.size(); m += patch.has_male() ? 1 : 0; }
     if (param_.og) os << static_cast<double>(s) / pop_.patches().size() << ' '; 
     if (param_.om) os << static_cast<double>(m) / pop_.patches().size() << ' ';
     if (param_.off) os << pop_.female_floater().size() << ' ';
@@ -315,7 +537,7 @@ namespace npm {
   std::ostream& Simulation::stream_xynR(std::ostream& os)
   {
     collect_xynR_visitor cav;
-    pop_.visit_patches(std::ref(cav));
+    for (size_t c = 0; c < chunk_.size() - 1; ++c) cav(buffers_[c].verdicts, pop_.patches());
     os << "xynR[[length(xynR)+1]] = matrix(c("; 
     for (auto const& x : cav.v_) 
     { 
@@ -335,44 +557,172 @@ namespace npm {
   }
 
 
-  void run_dispatch(Parameter& param)
+  //! Compares the takeover rates of the active colonization engine
+  //! with the serial engine, run on the same population states.
+  std::ostream& Simulation::stream_vcol(std::ostream& os)
+  {
+    auto rel = [](size_t a, size_t b) { return b ? (static_cast<double>(a) - static_cast<double>(b)) / static_cast<double>(b) : 0.0; };
+    const auto ticks = static_cast<double>(param_.ticks);
+    const auto& e = takeover_stats_;
+    const auto& s = vcol_serial_;
+    os << "Colonization check '" << colonization_name[param_.colonization] << "' vs. 'serial', per tick:\n";
+    os << "  attempts  " << e.attempt / ticks << " vs. " << s.attempt / ticks << "  (" << rel(e.attempt, s.attempt) << ")\n";
+    os << "  takeovers " << e.takeover / ticks << " vs. " << s.takeover / ticks << "  (" << rel(e.takeover, s.takeover) << ")\n";
+    os << "  walk-ins  " << e.walkin / ticks << " vs. " << s.walkin / ticks << "  (" << rel(e.walkin, s.walkin) << ")\n";
+    return os;
+  }
+
+
+  // model loop of policy combination I, see run_table
+  template <size_t I>
+  void run_policies(Simulation& sim)
+  {
+    constexpr auto BVOTE = static_cast<bVote>(I % bVote::BVOTE_MAX);
+    constexpr auto OVOTE = static_cast<oVote>(I / bVote::BVOTE_MAX % oVote::OVOTE_MAX);
+    constexpr auto PLACEMENT = static_cast<oPlacement>(I / (bVote::BVOTE_MAX * oVote::OVOTE_MAX) % oPlacement::OPLACEMENT_MAX);
+    constexpr auto MODE = static_cast<Mating>(I / (bVote::BVOTE_MAX * oVote::OVOTE_MAX * oPlacement::OPLACEMENT_MAX));
+    sim.run<MODE, PLACEMENT, OVOTE, BVOTE>();
+  }
+
+
+  template <size_t... I>
+  constexpr std::array<void (*)(Simulation&), sizeof...(I)> make_run_table(std::index_sequence<I...>)
+  {
+    return { &run_policies<I>... };
+  }
+
+
+  // model loops, indexed by [mode][oplacement][ovote][bvote] flattened
+  constexpr auto run_table = make_run_table(std::make_index_sequence<Mating::MATING_MAX * oPlacement::OPLACEMENT_MAX * oVote::OVOTE_MAX * bVote::BVOTE_MAX>());
+
+
+  void run_repetition(Parameter const& param, std::ostream& cout)
+  {
+    Simulation sim(param, cout);
+    const size_t policies = ((param.mode * oPlacement::OPLACEMENT_MAX + param.oplacement) * oVote::OVOTE_MAX + param.ovote) * bVote::BVOTE_MAX + param.bvote;
+    run_table[policies](sim);
+    if (param.R)
+    {
+      auto cmd = std::string("start ") + param.Rs + std::string(" RScript \"") + fs::absolute(param.offile).generic_string() + "\"";
+      if (param.oany) cout << "Executing: " << cmd << '\n';
+      auto err = std::system(cmd.c_str());
+    }
+    if (param.oany)
+    {
+      cout << "Repetition " << param.rep + 1 << " done.\n\n"; 
+    }
+  }
+
+
+  // expands the repetitions of a parameter set
+  std::vector<Parameter> expand_repetitions(Parameter const& param)
   {
     auto const rep = param.rep + param.repOfs;
     auto const ext = param.offile.extension();
     auto rof = param.offile;
     rof.replace_extension();
+    std::vector<Parameter> reps;
     for (size_t r = param.repOfs; r < rep; ++r)
     {
+      reps.push_back(param);
       if (rep > 1) 
       {  // adjust filename for this repetition
         auto ofn = rof;
         ofn += "_"; ofn += std::to_string(r + 1); ofn += ext;
-        param.offile = ofn;
-      }
-      param.rep = r;
-      Simulation sim(param);
-      param.mode == Mating::MATING_RANDOM
-        ? (param.oplacement == oPlacement::OPLACEMENT_BACK ? sim.run<Mating::MATING_RANDOM, oPlacement::OPLACEMENT_BACK>()
-           : sim.run<Mating::MATING_RANDOM, oPlacement::OPLACEMENT_SORT>())
-        : (param.oplacement == oPlacement::OPLACEMENT_BACK ? sim.run<Mating::MATING_RESIDENCY, oPlacement::OPLACEMENT_BACK>()
-           : sim.run<Mating::MATING_RESIDENCY, oPlacement::OPLACEMENT_SORT>());
-      if (param.R)
-      {
-        auto cmd = std::string("start ") + param.Rs + std::string(" RScript \"") + fs::absolute(param.offile).generic_string() + "\"";
-        if (param.oany) std::cout << "Executing: " << cmd << '\n';
-        auto err = std::system(cmd.c_str());
-      }
-      if (param.oany)
-      {
-        std::cout << "Repetition " << r + 1 << " done.\n\n"; 
+        reps.back().offile = ofn;
       }
+      reps.back().rep = r;
+    }
+    return reps;
+  }
+
+
+  // rough estimate of the run time of a parameter set
+  double estimated_cost(Parameter const& param)
+  {
+    return static_cast<double>(param.ticks) * static_cast<double>(param.m) * static_cast<double>(std::max<size_t>(param.F0, 1));
+  }
+
+
+  // runs the parameter sets longest first, 'jobs' at a time
+  void run_concurrent(std::vector<Parameter> const& runs, size_t jobs)
+  {
+    if (jobs == 0) jobs = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    std::vector<size_t> order(runs.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&runs](size_t a, size_t b)
+    {
+      return estimated_cost(runs[a]) > estimated_cost(runs[b]);
+    });
+    thread_pool pool(std::min(jobs, runs.size()));
+    pool.parallel_for(runs.size(), [&](size_t i)
+    {
+      auto const r = order[i];
+      line_prefix_buf buf(std::string("[") + runs[r].offile.stem().string() + "] ");
+      std::ostream cout(&buf);
+      run_repetition(runs[r], cout);
+    });
+  }
+
+
+  void run_dispatch(Parameter& param)
+  {
+    auto reps = expand_repetitions(param);
+    if (param.jobs == 1 || reps.size() < 2)
+    {
+      for (auto const& p : reps) run_repetition(p, std::cout);
+      return;
     }
+    run_concurrent(reps, param.jobs);
   }
 
+
+  // writes the manifest of a sweep
+  void write_manifest(std::vector<SweepJob> const& sweep, std::vector<size_t> const& job, std::vector<Parameter> const& runs, fs::path const& file)
+  {
+    std::ofstream os(file, std::fstream::out | std::fstream::trunc);
+    if (!os) 
+    { // complain about file creation failure
+      throw std::runtime_error((std::string("Can't create manifest file ") + file.string()).c_str());
+    }
+    os << "# Natal philopatry model sweep manifest\n";
+    os << "# Version " << Version << '\n';
+    os << "jobs <- data.frame(\n";
+    os << "  job = c(";
+    for (size_t i = 0; i < runs.size(); ++i) os << (i ? ", " : "") << job[i] + 1;
+    os << "),\n  rep = c(";
+    for (size_t i = 0; i < runs.size(); ++i) os << (i ? ", " : "") << runs[i].rep;
+    os << "),\n  file = c(";
+    for (size_t i = 0; i < runs.size(); ++i) os << (i ? ", " : "") << '\'' << fs::absolute(runs[i].offile).generic_string() << '\'';
+    os << "),\n  args = c(";
+    for (size_t i = 0; i < runs.size(); ++i) os << (i ? ", " : "") << "\"" << sweep[job[i]].args << "\"";
+    os << "),\n  stringsAsFactors = FALSE)\n";
+  }
+
+
   void Run(Parameter& param)
   {
-    Patch::SetupVotingSystem(param);
     run_dispatch(param);
   }
 
+
+  void RunSweep(std::vector<SweepJob> const& sweep, Parameter const& param)
+  {
+    std::vector<Parameter> runs;
+    std::vector<size_t> job;
+    for (size_t j = 0; j < sweep.size(); ++j)
+    {
+      auto reps = expand_repetitions(sweep[j].param);
+      runs.insert(runs.end(), reps.cbegin(), reps.cend());
+      job.insert(job.end(), reps.size(), j);
+    }
+    auto manifest = param.offile;
+    manifest.replace_extension();
+    manifest += "_manifest.R";
+    fs::create_directories(manifest.parent_path());
+    write_manifest(sweep, job, runs, manifest);
+    if (param.oany) std::cout << sweep.size() << " jobs, " << runs.size() << " runs. Manifest: " << manifest.generic_string() << '\n';
+    run_concurrent(runs, param.jobs);
+  }
+
 }
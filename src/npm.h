@@ -7,9 +7,12 @@
 #define NPM_NPM_H_INCLUDED
 
 #include <array>
+#include <cstdint>
+#include <vector>
 #include <string>
 #include <filesystem>
 #include "rndutils.hpp"
+#include "block_engine.h"
 
 
 namespace fs = std::filesystem;
@@ -22,8 +25,12 @@ namespace npm {
   extern const char* Version;
 
 
+  //! \brief random number engine type
+  using rnd_engine = block_engine<>;
+
+
   //! \brief random number engine
-  extern rndutils::xorshift128 thread_local RndEng;
+  extern rnd_engine thread_local RndEng;
 
 
   //! \brief Mutation distribution
@@ -69,10 +76,31 @@ namespace npm {
   };
 
 
+  //! \brief colonization engine
+  enum Colonization
+  {
+    COLONIZATION_SERIAL,    //!< one patch after the other
+    COLONIZATION_SHARDED,   //!< patch ranges in parallel
+    COLONIZATION_SPARSE,    //!< touched patches only
+    COLONIZATION_MAX
+  };
+
+
+  //! \brief precision of exp and pow in the reaction norms
+  enum Math
+  {
+    MATH_EXACT,           //!< std::exp, std::pow
+    MATH_FAST,            //!< polynomial approximation, see fast_exp
+    MATH_MAX
+  };
+
+
   extern const char* mating_name[Mating::MATING_MAX];
   extern const char* ovote_name[oVote::OVOTE_MAX];
   extern const char* bvote_name[bVote::BVOTE_MAX];
   extern const char* oplacement_name[oPlacement::OPLACEMENT_MAX];
+  extern const char* colonization_name[Colonization::COLONIZATION_MAX];
+  extern const char* math_name[Math::MATH_MAX];
   
 
   //! \brief allele gene loci
@@ -82,8 +110,19 @@ namespace npm {
   };
 
 
+#ifdef NPM_COMPACT_INDIVIDUALS
+  using allele_t = float;         //!< scalar type of an allele
+  using age_t = uint16_t;         //!< age, saturates
+  using rank_t = uint16_t;        //!< mothers rank
+#else
+  using allele_t = double;        //!< scalar type of an allele
+  using age_t = unsigned;         //!< age, saturates
+  using rank_t = unsigned;        //!< mothers rank
+#endif
+
+
   //! \brief A set of alleles, e.g. {A0,A1,A2,...,B0,B1,B2,...}
-  using Alleles = std::array<double, MAX_ALLELE>;
+  using Alleles = std::array<allele_t, MAX_ALLELE>;
 
 
   //! \brief Helper class to track takeovers
@@ -143,6 +182,9 @@ namespace npm {
     size_t ticks = 1000;                      //!< Time ticks to run
     size_t rep = 1;                           //!< Repetitions
     size_t repOfs = 0;                        //!< Start of repetition counter
+    size_t threads = 0;                       //!< threads in the patch loop, 0: serial loop
+    uint64_t seed = 0;                        //!< random seed
+    size_t jobs = 1;                          //!< concurrent repetitions or sweep jobs, 0: all cores
     bool R = false;                           //!< invoke R server with result file
     std::string Rs = "/B";                    //!< R start command
     size_t log = 0;                           //!< log interval
@@ -165,6 +207,9 @@ namespace npm {
     oVote ovote = oVote::OVOTE_ACCOUNT;             //!< offspring vote
     bVote bvote = bVote::BVOTE_DESPOTIC;            //!< breeder vote
     oPlacement oplacement = oPlacement::OPLACEMENT_SORT; //!< offspring placement mode
+    Colonization colonization = Colonization::COLONIZATION_SERIAL; //!< colonization engine
+    Math math = Math::MATH_EXACT;             //!< precision of exp and pow
+    bool vcol = false;                        //!< validate colonization engine against the serial one
 
 
     double thetaB() const { return (Sb - Smax * (1.0 - std::exp(-sigma))) / std::exp(-sigma); }
@@ -172,11 +217,56 @@ namespace npm {
   };
 
 
+  //! \brief A job of a parameter sweep
+  struct SweepJob
+  {
+    Parameter param;      //!< the parameter set
+    std::string args;     //!< the sweep arguments that lead to param
+  };
+
+
+  //! \brief Domains of random streams, part of the stream key
+  enum Stream : uint64_t
+  {
+    STREAM_MASTER = 0,                  //!< the sequential stream of a repetition
+    STREAM_PATCH = 1ull << 48,          //!< patch loop, key | patch index
+    STREAM_COLONIZATION = 2ull << 48,   //!< sharded colonization, key | shard index
+    STREAM_VCOL = 3ull << 48            //!< serial colonization dry run
+  };
+
+
+  //! \brief Seeds the calling threads RndEng for a random stream
+  //! \param param parameter set, provides seed and rep
+  //! \param tick time tick (32 bit)
+  //! \param key stream key, Stream | index
+  //!
+  //! The stream is derived from the counter-based philox generator,
+  //! keyed by (seed, rep, tick, key). Thus it does not depend on
+  //! the thread that happens to use it nor on any other stream.
+  inline void seed_stream(Parameter const& param, uint64_t tick, uint64_t key)
+  {
+    using ctr_type = rndutils::philox4x32::ctr_type;
+    const auto b = rndutils::philox4x32::block(ctr_type{ { static_cast<uint32_t>(param.rep), static_cast<uint32_t>(tick),
+                                                           static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32u) } },
+                                               param.seed);
+    RndEng.seed((static_cast<uint64_t>(b[1]) << 32u) | b[0], (static_cast<uint64_t>(b[3]) << 32u) | b[2]);
+  }
+
+
   //! \brief Run the model
   //! \param param the parameter set
   void Run(Parameter& param);
 
 
+  //! \brief Run a parameter sweep
+  //! \param sweep the jobs
+  //! \param param the parameter set from the command line
+  //!
+  //! Runs the jobs longest first, param.jobs at a time
+  //! and writes the manifest <param.offile>_manifest.R
+  void RunSweep(std::vector<SweepJob> const& sweep, Parameter const& param);
+
+
 }
 
 
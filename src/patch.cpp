@@ -4,18 +4,31 @@
 
 #include <random>
 #include <algorithm>
+#include <cassert>
 #include "patch.h"
+#include "math_mode.h"
+#include "survival.h"
 
 
 namespace npm {
 
-  namespace {
-
-    // member function pointers of the voting system
-    double (Patch::*offspring_vote_pmf)(size_t) const;
-    double (Patch::*breeder_vote_pmf)(size_t) const;
-
-  }
+  // declaration of the voting system specializations
+  template <> double Patch::offspring_vote<oVote::OVOTE_IGNORE>(patch_scratch const&, size_t) const;
+  template <> double Patch::offspring_vote<oVote::OVOTE_ACCOUNT>(patch_scratch const&, size_t) const;
+  template <> double Patch::breeder_vote<bVote::BVOTE_IGNORE>(patch_scratch const&, size_t) const;
+  template <> double Patch::breeder_vote<bVote::BVOTE_KIN>(patch_scratch const&, size_t) const;
+  template <> double Patch::breeder_vote<bVote::BVOTE_DESPOTIC>(patch_scratch const&, size_t) const;
+  template <> double Patch::breeder_vote<bVote::BVOTE_EGALITARIAN>(patch_scratch const&, size_t) const;
+  template <> double Patch::breeder_vote<bVote::BVOTE_HIERARCHICAL>(patch_scratch const&, size_t) const;
+  template <> void Patch::accept_probabilities<bVote::BVOTE_IGNORE>(IndividualStore const&, Math, patch_scratch&) const;
+  template <> void Patch::accept_probabilities<bVote::BVOTE_KIN>(IndividualStore const&, Math, patch_scratch&) const;
+  template <> void Patch::accept_probabilities<bVote::BVOTE_DESPOTIC>(IndividualStore const&, Math, patch_scratch&) const;
+  template <> void Patch::accept_probabilities<bVote::BVOTE_EGALITARIAN>(IndividualStore const&, Math, patch_scratch&) const;
+  template <> void Patch::accept_probabilities<bVote::BVOTE_HIERARCHICAL>(IndividualStore const&, Math, patch_scratch&) const;
+  template <> handle_t Patch::sire<Mating::MATING_RANDOM>(container_t const&) const;
+  template <> handle_t Patch::sire<Mating::MATING_RESIDENCY>(container_t const&) const;
+  template <> void Patch::place_daughters<oPlacement::OPLACEMENT_BACK>(container_t&, patch_scratch&, xynR_type const*);
+  template <> void Patch::place_daughters<oPlacement::OPLACEMENT_SORT>(container_t&, patch_scratch&, xynR_type const*);
 
 
   //! \brief patch fecundity probability
@@ -24,280 +37,411 @@ namespace npm {
     //! \param param the parameter set
     //! \param n number of occupied sites
     fecundity(Parameter const& param, double n)
-    : fact( param.F0 * (1.0 - param.phi * n) * (1.0 - std::exp(-param.k * n)) ),
-      delta(param.delta)
+    : fact( param.F0 * (1.0 - param.phi * n) * (1.0 - math_exp(-param.k * n, param.math)) ),
+      delta(param.delta),
+      math(param.math)
     {}
 
     //! \param Rank rank of the mother in spe
     //! \returns F(n,R)
     double operator()(double Rank) const 
     {
-      return fact * std::pow(Rank, -delta);
+      return fact * rank_power(Rank, delta, math);
     }
 
     const double fact;
     const double delta;
+    const Math math;
   };
 
 
-  //! \brief Probability for offspring to stay on a patch
-  //! \param x an individual
+  //! \brief Probabilities for the daughters to stay on a patch
+  //! \param store the individuals
   //! \param n number of occupied sites
-  //! \param R rank of the mother
-  //!
-  //! \returns x(n, R)
-  inline double stay_probability(Individual const& x, double n, double R)
+  //! \param math precision of the exponential
+  //! \param s the scratch with the daughters, receives x(n, R) in s.x
+  inline void stay_probabilities(IndividualStore const& store, double n, Math math, patch_scratch& s)
+  {
+    s.batch.gather<B0, B1, B2>(store, s.female_offspring.size(),
+      [&s](size_t i) { return s.female_offspring[i]; },
+      [&s](size_t i) { return s.R[i]; });
+    s.x.resize(s.batch.size());
+    logistic(s.batch, n, math, s.x.data());
+  }
+
+
+  //! \brief Draws the verdicts of the polls
+  //! \param s the scratch with the daughters, receives the outcomes in s.stay
+  //! \param verdict the poll outcomes, one per daughter
+  //! \returns s.stay, non-zero if the daughter stays on the patch
+  inline uint64_t const* draw_stay(patch_scratch& s, xynR_type const* verdict)
   {
-    return 1.0 / (1.0 + std::exp(x.phen[B0] + n * x.phen[B1] + R * x.phen[B2]));
+    const size_t n = s.female_offspring.size();
+    s.stay.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+      s.stay[i] = rndutils::bernoulli_threshold(verdict[i].x * verdict[i].y);
+    }
+    rndutils::generate_bernoulli_n(n, s.stay.data(), RndEng, s.stay.data());
+    return s.stay.data();
   }
 
 
   //! \brief Probability to accept an offspring
+  //! \param store the individuals
   //! \param x an individual
   //! \param n number of occupied sites
   //! \param R rank of the mother
+  //! \param math precision of the exponential
   //!
   //! \returns y(n, R)
-  inline double accept_probability(Individual const& x, double n, double R)
+  inline double accept_probability(IndividualStore const& store, handle_t x, double n, double R, Math math)
   {
-    return 1.0 / (1.0 + std::exp(x.phen[A0] + n * x.phen[A1] + R * x.phen[A2]));
+    return 1.0 / (1.0 + math_exp(store.phen<A0>(x) + n * store.phen<A1>(x) + R * store.phen<A2>(x), math));
   }
 
 
-  Patch::Patch(Individual const& dominant, Individual const* male)
+  void Patch::attach(handle_t* first, size_t capacity)
   {
-    breeder_.assign(1, dominant);
-    if (male) set_male(*male);
+    assert(n_ <= capacity);
+    std::copy(breeder_, breeder_ + n_, first);
+    breeder_ = first;
+    capacity_ = capacity;
   }
 
 
-  void do_mortality(container_t& c, double SurvivalProp)
+  void Patch::push_breeder(handle_t h)
   {
-    std::bernoulli_distribution bernoulli_P(1.0 - SurvivalProp);
-    c.erase(std::remove_if(c.begin(), c.end(), [&bernoulli_P](Individual& ind)
+    assert(n_ < capacity_);
+    breeder_[n_++] = h;
+  }
+
+
+  // returns the number of survivors, they are moved to the front
+  size_t do_mortality(IndividualStore const& store, handle_t* first, size_t n, double SurvivalProp)
+  {
+    return survival_sweep(first, first + n, 1.0 - SurvivalProp, [&store](handle_t ind)
     {
-      return (ind.age > 0) && (bernoulli_P(RndEng));
-    }), c.end());
+      return store.age(ind) == 0;
+    }, RndEng) - first;
   }
 
 
-  void Patch::do_survival(Parameter const& param)
+  void Patch::do_survival(Parameter const& param, IndividualStore const& store)
   {
-    auto n = static_cast<double>(breeder_.size());
+    auto n = static_cast<double>(n_);
     auto thetaB = param.thetaB(); 
     auto thetaM = param.thetaM(); 
-    do_mortality(breeder_, thetaB + (param.Smax - thetaB) * (1.0 - std::exp(-param.sigma * n)));
-    do_mortality(male_, thetaM + (param.Smax - thetaM) * (1.0 - std::exp(-param.sigma * n)));
+    n_ = do_mortality(store, breeder_, n_, thetaB + (param.Smax - thetaB) * (1.0 - math_exp(-param.sigma * n, param.math)));
+    if (has_male() && do_mortality(store, &male_, 1, thetaM + (param.Smax - thetaM) * (1.0 - math_exp(-param.sigma * n, param.math))) == 0)
+    {
+      male_ = no_handle;
+    }
   }
 
 
-  template <>
-  void Patch::do_reproduction<Mating::MATING_RANDOM>(Parameter const& param, container_t const& male_floater)
+  template <Mating MODE, oVote OVOTE, bVote BVOTE>
+  void Patch::do_reproduction(Parameter const& param, IndividualStore& store, container_t const& male_floater, StoreBlock& block, patch_scratch& scratch)
   {
-    prepare_reproduction();
-    if (!(male_floater.empty() || empty()))
+    scratch.clear();
+    if (!empty())
     {
-      // select male at random
-      rndutils::uniform_signed_distribution<> rndMale(0, (int)male_floater.size() - 1);
-      Individual const* male = &male_floater[rndMale(RndEng)];
-      create_offsprings(param, *male);
+      const handle_t male = sire<MODE>(male_floater);
+      if (male != no_handle)
+      {
+        create_offsprings<OVOTE, BVOTE>(param, store, male, block, scratch);
+      }
     }
   }
-  
 
+
+  // select male at random
   template <>
-  void Patch::do_reproduction<Mating::MATING_RESIDENCY>(Parameter const& param,container_t const&)
+  handle_t Patch::sire<Mating::MATING_RANDOM>(container_t const& male_floater) const
   {
-    prepare_reproduction();
-    if (!(male_.empty() || empty()))
-    {
-      create_offsprings(param, male_[0]);
-    }
+    if (male_floater.empty()) return no_handle;
+    rndutils::uniform_signed_distribution<> rndMale(0, (int)male_floater.size() - 1);
+    return male_floater[rndMale(RndEng)];
   }
 
 
-  void Patch::prepare_reproduction()
+  template <>
+  handle_t Patch::sire<Mating::MATING_RESIDENCY>(container_t const&) const
   {
-    female_offspring_.clear();
-    male_offspring_.clear();
-    x_.clear();
-    y_.clear();
-    R_.clear();
-    verdict_.clear();
+    return male_;
   }
 
 
-  void Patch::create_offsprings(Parameter const& param, Individual const& male)
+  template <oVote OVOTE, bVote BVOTE>
+  void Patch::create_offsprings(Parameter const& param, IndividualStore& store, handle_t male, StoreBlock& block, patch_scratch& scratch)
   {
     rndutils::binary_distribution binary_dist;
-    double n = static_cast<double>(breeder_.size());
+    std::binomial_distribution<int> brood_dist;
+    double n = static_cast<double>(n_);
     auto fecundityP = fecundity(param, n);
-    for (size_t i = 0; i < breeder_.size(); ++i)
+    const auto F0 = static_cast<int>(param.F0);
+    const size_t most = n_ * param.F0;
+    scratch.female_offspring.reserve(most);
+    scratch.male_offspring.reserve(most);
+    scratch.R.reserve(most);
+    scratch.male_R.reserve(most);
+    for (size_t i = 0; i < n_; ++i)
     {
       auto R = static_cast<double>(i + 1);
-      y_.push_back( accept_probability(breeder_[i], n, R) );
-      const auto Pf = fecundityP(R);
-      std::bernoulli_distribution bernoulli_fecundity( std::max(0.0, Pf) );
-      for (int k=0; k<param.F0; ++k) 
+      const auto Pf = std::min(1.0, std::max(0.0, fecundityP(R)));
+      // brood size ~ Binomial(F0, F(n,R)), number of daughters ~ Binomial(brood, 0.5)
+      int brood = 0, daughters = 0;
+      if (F0 == 1)
+      {
+        brood = rndutils::bernoulli_trial(RndEng, rndutils::bernoulli_threshold(Pf));
+        daughters = brood ? binary_dist(RndEng) : 0;
+      }
+      else if (F0 > 1)
+      {
+        brood = brood_dist(RndEng, decltype(brood_dist)::param_type(F0, Pf));
+        daughters = (brood > 1) ? rndutils::binomial50_small_distribution<int>(brood)(RndEng) : (brood ? binary_dist(RndEng) : 0);
+      }
+      for (int k = 0; k < brood; ++k)
       {
-        if (bernoulli_fecundity(RndEng))
+        auto h = block.allocate();
+        if (k < daughters)
+        {
+          scratch.female_offspring.push_back(h);
+          scratch.R.push_back(static_cast<unsigned>(i + 1));
+        }
+        else
         {
-          if (binary_dist(RndEng))
-          { // female offspring
-            female_offspring_.emplace_back(param, breeder_[i], male, static_cast<unsigned>(i + 1));
-            x_.push_back(stay_probability(female_offspring_.back(), n, R));
-            R_.push_back(static_cast<unsigned>(i + 1));
-          }
-          else
-          {  // male offspring
-            male_offspring_.emplace_back(param, breeder_[i], male, static_cast<unsigned>(i + 1));
-          }
+          scratch.male_offspring.push_back(h);
+          scratch.male_R.push_back(static_cast<unsigned>(i + 1));
         }
       }
     }
+    store.create_offspring(scratch.female_offspring.data(), scratch.R.data(), scratch.female_offspring.size(), breeder_, male, param);
+    store.create_offspring(scratch.male_offspring.data(), scratch.male_R.data(), scratch.male_offspring.size(), breeder_, male, param);
+    // nobody to vote on without daughters
+    if (!scratch.female_offspring.empty())
+    {
+      if (OVOTE != oVote::OVOTE_IGNORE) stay_probabilities(store, n, param.math, scratch);
+      accept_probabilities<BVOTE>(store, param.math, scratch);
+    }
   }
 
 
-  void Patch::disperse_males_and_poll(container_t& male_floater)
+  template <oVote OVOTE, bVote BVOTE>
+  void Patch::disperse_males_and_poll(container_t& male_floater, patch_scratch const& scratch, verdict_table& verdicts, size_t index)
   {
     // males goes en block to the male floater pool.
-    male_floater.insert(male_floater.end(), male_offspring_.begin(), male_offspring_.end());
+    male_floater.insert(male_floater.end(), scratch.male_offspring.begin(), scratch.male_offspring.end());
     if (empty()) 
     { // lonely males become floaters again
-      male_floater.insert(male_floater.end(), male_.begin(), male_.end());
-      male_.clear();
+      if (has_male()) male_floater.push_back(male_);
+      male_ = no_handle;
       return;
     }
 
     // perform the poll
-    auto const oldN = breeder_.size();
-    for (size_t i = 0; i < female_offspring_.size(); ++i)
+    auto const oldN = n_;
+    const size_t first = verdicts.xynR.size();
+    for (size_t i = 0; i < scratch.female_offspring.size(); ++i)
     {
-      verdict_.push_back({ (this->*offspring_vote_pmf)(i), (this->*breeder_vote_pmf)(i), oldN, R_[i] });
+      verdicts.xynR.push_back({ offspring_vote<OVOTE>(scratch, i), breeder_vote<BVOTE>(scratch, i), oldN, scratch.R[i] });
     }
+    if (first != verdicts.xynR.size()) verdicts.polls.push_back({ index, first, verdicts.xynR.size() });
+  }
+
+
+  template <oPlacement PLACEMENT, oVote OVOTE, bVote BVOTE>
+  void Patch::do_dispersal(container_t& female_floater, container_t& male_floater, patch_scratch& scratch, verdict_table& verdicts, size_t index)
+  {
+    const size_t first = verdicts.xynR.size();
+    disperse_males_and_poll<OVOTE, BVOTE>(male_floater, scratch, verdicts, index);
+    place_daughters<PLACEMENT>(female_floater, scratch, verdicts.xynR.data() + first);
   }
 
 
   template <>
-  void Patch::do_dispersal<oPlacement::OPLACEMENT_BACK>(Parameter const& param, container_t& female_floater, container_t& male_floater)
+  void Patch::place_daughters<oPlacement::OPLACEMENT_BACK>(container_t& female_floater, patch_scratch& scratch, xynR_type const* verdict)
   {
-    disperse_males_and_poll(male_floater);
-    auto const oldN = breeder_.size();
-    for (size_t i = 0; i < female_offspring_.size(); ++i)
+    auto const oldN = n_;
+    auto const stay = draw_stay(scratch, verdict);
+    for (size_t i = 0; i < scratch.female_offspring.size(); ++i)
     {
-      if (std::bernoulli_distribution(verdict_[i].x * verdict_[i].y)(RndEng))
+      if (stay[i])
       { // stay on patch
-        breeder_.emplace_back(female_offspring_[i]);
+        push_breeder(scratch.female_offspring[i]);
       }
       else
       { // emigrate to floater pool
-        female_floater.push_back(female_offspring_[i]);
+        female_floater.push_back(scratch.female_offspring[i]);
       }
     }
     // Shuffle new breeders
-    std::shuffle(breeder_.begin() + oldN, breeder_.end(), RndEng);
+    std::shuffle(breeder_ + oldN, breeder_ + n_, RndEng);
   }
 
 
   template <>
-  void Patch::do_dispersal<oPlacement::OPLACEMENT_SORT>(Parameter const& param, container_t& female_floater, container_t& male_floater)
+  void Patch::place_daughters<oPlacement::OPLACEMENT_SORT>(container_t& female_floater, patch_scratch& scratch, xynR_type const* verdict)
   {
-    disperse_males_and_poll(male_floater);
-    size_t rank_shift = 0;
-    for (size_t i = 0; i < female_offspring_.size(); ++i)
+    auto const stay = draw_stay(scratch, verdict);
+    size_t k = 0;   // staying daughters, staged in front of the scratch
+    for (size_t i = 0; i < scratch.female_offspring.size(); ++i)
     {
-      if (std::bernoulli_distribution(verdict_[i].x * verdict_[i].y)(RndEng))
+      if (stay[i])
       { // stay on patch
-        auto pos = breeder_.begin() + (R_[i] + rank_shift++);
-        breeder_.insert(pos, female_offspring_[i]);
+        scratch.female_offspring[k] = scratch.female_offspring[i];
+        scratch.R[k++] = scratch.R[i];
       }
       else
       { // emigrate to floater pool
-        female_floater.push_back(female_offspring_[i]);
+        female_floater.push_back(scratch.female_offspring[i]);
       }
     }
+    assert(n_ + k <= capacity_);
+    if (scratch.shift.size() < n_) scratch.shift.resize(n_);
+    merge_daughters(breeder_, n_, scratch.female_offspring.data(), scratch.R.data(), k, scratch.shift.data());
+    n_ += k;
   }
 
 
-  void Patch::do_colonization(Parameter const& param, Individual const& floater)
+  void Patch::do_colonization(Parameter const& param, handle_t floater)
   {
-    breeder_.assign(1, floater);
+    assert(capacity_ > 0);
+    breeder_[0] = floater;
+    n_ = 1;
   }
 
 
   // Voting system
   
-  template <> double Patch::offspring_vote<oVote::OVOTE_IGNORE>(size_t) const
+  template <> double Patch::offspring_vote<oVote::OVOTE_IGNORE>(patch_scratch const&, size_t) const
   {
     return 1.0;
   }
 
 
-  template <> double Patch::offspring_vote<oVote::OVOTE_ACCOUNT>(size_t ioffs) const
+  template <> double Patch::offspring_vote<oVote::OVOTE_ACCOUNT>(patch_scratch const& s, size_t ioffs) const
   {
-    return x_[ioffs];
+    return s.x[ioffs];
   }
 
 
-  template <> double Patch::breeder_vote<bVote::BVOTE_IGNORE>(size_t) const
+  template <> double Patch::breeder_vote<bVote::BVOTE_IGNORE>(patch_scratch const&, size_t) const
   {
     return 1.0;
   }
 
 
-  template <> double Patch::breeder_vote<bVote::BVOTE_KIN>(size_t ioffs) const
+  template <> double Patch::breeder_vote<bVote::BVOTE_KIN>(patch_scratch const& s, size_t ioffs) const
   {
-    return y_[R_[ioffs] - 1];
+    return s.y[s.R[ioffs] - 1];
   }
 
 
-  template <> double Patch::breeder_vote<bVote::BVOTE_DESPOTIC>(size_t) const
+  template <> double Patch::breeder_vote<bVote::BVOTE_DESPOTIC>(patch_scratch const& s, size_t) const
   {
-    return y_[0];
+    return s.y[0];
   }
 
 
-  template <> double Patch::breeder_vote<bVote::BVOTE_EGALITARIAN>(size_t) const
+  template <> double Patch::breeder_vote<bVote::BVOTE_EGALITARIAN>(patch_scratch const& s, size_t) const
   {
-    double res = 0.0;
-    auto N = breeder_.size();
-    for (size_t j = 0; j < N; ++j)
-    {
-      res += y_[j];
-    }
-    return res / N;
+    return s.y[n_ - 1] / n_;
   }
 
 
-  template <> double Patch::breeder_vote<bVote::BVOTE_HIERARCHICAL>(size_t ioffs) const
+  template <> double Patch::breeder_vote<bVote::BVOTE_HIERARCHICAL>(patch_scratch const& s, size_t ioffs) const
   {
-    double res = 0.0;
-    auto N = static_cast<size_t>(R_[ioffs]);
-    for (size_t j = 0; j < N; ++j)
-    {
-      res += y_[j];
-    }
-    return res / N;
- }
+    auto N = static_cast<size_t>(s.R[ioffs]);
+    return s.y[N - 1] / N;
+  }
+
+
+  // Accept probabilities needed by the voting system, in scratch.y.
+  // Only called if there are female offspring.
+
+  template <> void Patch::accept_probabilities<bVote::BVOTE_IGNORE>(IndividualStore const&, Math, patch_scratch&) const
+  {
+  }
 
 
-  void Patch::SetupVotingSystem(Parameter const& param)
+  // y(n,R) of the mothers, other breeders are left alone
+  template <> void Patch::accept_probabilities<bVote::BVOTE_KIN>(IndividualStore const& store, Math math, patch_scratch& s) const
   {
-    switch (param.ovote)
+    // distinct ranks of the mothers
+    s.mothers.clear();
+    for (size_t i = 0; i < s.R.size(); ++i)
     {
-      case oVote::OVOTE_IGNORE: offspring_vote_pmf = &Patch::offspring_vote<oVote::OVOTE_IGNORE>; break;
-      case oVote::OVOTE_ACCOUNT: offspring_vote_pmf = &Patch::offspring_vote<oVote::OVOTE_ACCOUNT>; break;
+      if (i == 0 || s.R[i] != s.R[i - 1]) s.mothers.push_back(s.R[i]);
     }
-    switch (param.bvote)
+    s.batch.gather<A0, A1, A2>(store, s.mothers.size(),
+      [this, &s](size_t i) { return breeder_[s.mothers[i] - 1]; },
+      [&s](size_t i) { return s.mothers[i]; });
+    s.p.resize(s.batch.size());
+    logistic(s.batch, static_cast<double>(n_), math, s.p.data());
+    s.y.resize(n_);
+    for (size_t i = 0; i < s.batch.size(); ++i)
     {
-      case bVote::BVOTE_IGNORE: breeder_vote_pmf = &Patch::breeder_vote<bVote::BVOTE_IGNORE>; break;
-      case bVote::BVOTE_KIN: breeder_vote_pmf = &Patch::breeder_vote<bVote::BVOTE_KIN>; break;
-      case bVote::BVOTE_DESPOTIC: breeder_vote_pmf = &Patch::breeder_vote<bVote::BVOTE_DESPOTIC>; break;
-      case bVote::BVOTE_EGALITARIAN: breeder_vote_pmf = &Patch::breeder_vote<bVote::BVOTE_EGALITARIAN>; break;
-      case bVote::BVOTE_HIERARCHICAL: breeder_vote_pmf = &Patch::breeder_vote<bVote::BVOTE_HIERARCHICAL>; break;
+      s.y[s.mothers[i] - 1] = s.p[i];
     }
   }
 
 
-}
+  // y(n,1) only
+  template <> void Patch::accept_probabilities<bVote::BVOTE_DESPOTIC>(IndividualStore const& store, Math math, patch_scratch& s) const
+  {
+    s.y.push_back(accept_probability(store, breeder_[0], static_cast<double>(n_), 1.0, math));
+  }
+
+
+  // prefix sums of y(n,R) of the first N breeders
+  inline void accept_prefix_sums(IndividualStore const& store, handle_t const* breeder, size_t n, size_t N, Math math, patch_scratch& s)
+  {
+    s.batch.gather<A0, A1, A2>(store, N,
+      [breeder](size_t j) { return breeder[j]; },
+      [](size_t j) { return j + 1; });
+    s.y.resize(N);
+    logistic(s.batch, static_cast<double>(n), math, s.y.data());
+    for (size_t j = 1; j < N; ++j)
+    {
+      s.y[j] += s.y[j - 1];
+    }
+  }
+
+
+  // prefix sums of y(n,R) over the whole hierarchy
+  template <> void Patch::accept_probabilities<bVote::BVOTE_EGALITARIAN>(IndividualStore const& store, Math math, patch_scratch& s) const
+  {
+    accept_prefix_sums(store, breeder_, n_, n_, math, s);
+  }
+
+
+  // prefix sums of y(n,R) down to the lowest ranking mother
+  template <> void Patch::accept_probabilities<bVote::BVOTE_HIERARCHICAL>(IndividualStore const& store, Math math, patch_scratch& s) const
+  {
+    accept_prefix_sums(store, breeder_, n_, s.R.back(), math, s);
+  }
+
+
+  // Explicit instantiation of the policy combinations
+
+#define NPM_PATCH_INSTANTIATE(OVOTE, BVOTE) \
+  template void Patch::do_reproduction<Mating::MATING_RANDOM, OVOTE, BVOTE>(Parameter const&, IndividualStore&, container_t const&, StoreBlock&, patch_scratch&); \
+  template void Patch::do_reproduction<Mating::MATING_RESIDENCY, OVOTE, BVOTE>(Parameter const&, IndividualStore&, container_t const&, StoreBlock&, patch_scratch&); \
+  template void Patch::do_dispersal<oPlacement::OPLACEMENT_BACK, OVOTE, BVOTE>(container_t&, container_t&, patch_scratch&, verdict_table&, size_t); \
+  template void Patch::do_dispersal<oPlacement::OPLACEMENT_SORT, OVOTE, BVOTE>(container_t&, container_t&, patch_scratch&, verdict_table&, size_t);
 
+#define NPM_PATCH_INSTANTIATE_BVOTES(OVOTE) \
+  NPM_PATCH_INSTANTIATE(OVOTE, bVote::BVOTE_IGNORE) \
+  NPM_PATCH_INSTANTIATE(OVOTE, bVote::BVOTE_KIN) \
+  NPM_PATCH_INSTANTIATE(OVOTE, bVote::BVOTE_DESPOTIC) \
+  NPM_PATCH_INSTANTIATE(OVOTE, bVote::BVOTE_EGALITARIAN) \
+  NPM_PATCH_INSTANTIATE(OVOTE, bVote::BVOTE_HIERARCHICAL)
+
+  NPM_PATCH_INSTANTIATE_BVOTES(oVote::OVOTE_IGNORE)
+  NPM_PATCH_INSTANTIATE_BVOTES(oVote::OVOTE_ACCOUNT)
+
+#undef NPM_PATCH_INSTANTIATE_BVOTES
+#undef NPM_PATCH_INSTANTIATE
+
+}
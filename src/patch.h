@@ -9,7 +9,10 @@
 #include <vector>
 #include <cmath>
 #include <memory>
-#include "individual.h"
+#include <algorithm>
+#include <cassert>
+#include "individual_store.h"
+#include "logistic.h"
 
 
 namespace npm {
@@ -25,99 +28,215 @@ namespace npm {
   };
 
 
-  // container type for individuals
-  typedef std::vector<Individual> container_t;
+  // container type for individuals, handles into the IndividualStore
+  typedef std::vector<handle_t> container_t;
+
+
+  //! \brief Transient state of a patch during reproduction and dispersal
+  //!
+  //! Lives only from do_reproduction to do_dispersal of the same patch,
+  //! thus one scratch per thread is reused patch after patch.
+  struct patch_scratch
+  {
+    container_t female_offspring;
+    container_t male_offspring;
+    std::vector<double> x;              //!< offspring stay prob
+    std::vector<double> y;              //!< mothers accept prob as needed by the bVote rule
+    std::vector<unsigned> R;            //!< rank of mother == position of mother + 1
+    std::vector<unsigned> male_R;       //!< rank of mother of the male offspring
+    std::vector<unsigned> shift;        //!< workspace of merge_daughters
+    logistic_batch batch;               //!< workspace of x and y
+    std::vector<unsigned> mothers;      //!< workspace of y
+    std::vector<double> p;              //!< workspace of y
+    std::vector<uint64_t> stay;         //!< workspace of place_daughters
+
+    void clear()
+    {
+      female_offspring.clear();
+      male_offspring.clear();
+      x.clear();
+      y.clear();
+      R.clear();
+      male_R.clear();
+    }
+  };
+
+
+  //! \brief The outcome of the polls of consecutive patches in one tick
+  struct verdict_table
+  {
+    //! \brief poll of one patch
+    struct poll
+    {
+      size_t patch;                     //!< index of the patch
+      size_t first;                     //!< first entry in xynR
+      size_t last;                      //!< one past the last entry in xynR
+    };
+
+    std::vector<xynR_type> xynR;        //!< poll outcome per female offspring, patch by patch
+    std::vector<poll> polls;            //!< polls of the patches with female offspring
+
+    void clear()
+    {
+      xynR.clear();
+      polls.clear();
+    }
+  };
+
+
+  //! \brief View of consecutive handles
+  class handle_span
+  {
+  public:
+    handle_span(handle_t const* first, size_t n) : first_(first), n_(n) {}
+
+    handle_t const* begin() const { return first_; }
+    handle_t const* end() const { return first_ + n_; }
+    size_t size() const { return n_; }
+    bool empty() const { return n_ == 0; }
+    handle_t operator[](size_t i) const { return first_[i]; }
+
+  private:
+    handle_t const* first_;
+    size_t n_;
+  };
+
+
+  //! \brief Merges daughters into their mothers hierarchy
+  //! \param breeder the breeders, room for n + k
+  //! \param n number of breeders
+  //! \param daughter the daughters, ordered by mothers rank
+  //! \param R mothers rank of the daughters
+  //! \param k number of daughters
+  //! \param shift workspace, room for n
+  //!
+  //! Every daughter is placed below her mother and her older sisters.
+  //! Same order as inserting the daughters one after the other
+  //! at position R + number of daughters inserted before, but in O(n + k).
+  inline void merge_daughters(handle_t* breeder, size_t n, handle_t const* daughter, unsigned const* R, size_t k, unsigned* shift)
+  {
+    if (k == 0) return;
+    // breeder j moves down by the number of daughters with R <= j
+    const size_t r0 = R[0];
+    std::fill(shift + r0, shift + n, 0u);
+    for (size_t i = 0; i < k; ++i)
+    {
+      if (R[i] < n) ++shift[R[i]];
+    }
+    unsigned s = 0;
+    for (size_t j = r0; j < n; ++j)
+    {
+      shift[j] = (s += shift[j]);
+    }
+    for (size_t j = n; j-- > r0;)
+    {
+      breeder[j + shift[j]] = breeder[j];
+    }
+    // daughter i ends up below R[i] breeders and i sisters
+    for (size_t i = 0; i < k; ++i)
+    {
+      breeder[R[i] + i] = daughter[i];
+    }
+  }
 
 
   //! \brief A patch
   //!
   //! A patch is a collection of breeders. A.k.a home-range
   //! The first breeder in the collection is the dominant one.
+  //! The individuals themselves live in the IndividualStore.
+  //! The breeders of all patches share one array owned by the population,
+  //! a patch is a view of its slice in there, see Population::layout_patches.
   class Patch
   {
   public:
-    static void SetupVotingSystem(Parameter const& param);
-
-    //! \brief creates an empty patch
+    //! \brief creates an empty patch without breeder slots
     Patch() = default;
 
-    //! \brief creates an occupied patch
-    //! \param dominant The individual that becomes dominant
-    //! \param male The individual that becomes male breeder (could be 0)
-    explicit Patch(Individual const& dominant, const Individual* male);
-    
+    //! \brief Moves the breeders into new slots
+    //! \param first the first slot
+    //! \param capacity number of slots, at least size()
+    void attach(handle_t* first, size_t capacity);
+
+    //! \brief Releases the slots of an empty patch
+    void detach() { assert(n_ == 0); breeder_ = nullptr; capacity_ = 0; }
+
+    //! \brief Returns true if the patch has breeder slots
+    bool attached() const { return capacity_ > 0; }
+
     //! \brief Returns true if the patch is empty
-    bool empty() const { return breeder_.empty(); }
+    bool empty() const { return n_ == 0; }
 
     //! Returns number of breeders
-    size_t size() const { return breeder_.size(); }
+    size_t size() const { return n_; }
 
-    //! \brief Returns an pointer to the breeding male
-    //! If the returned pointer is nullptr, no breeding male
-    //! exist on the patch.
-    Individual const* male() const { return male_.empty() ? nullptr : &*male_.cbegin(); }
+    //! \brief Returns true if there is a breeding male on the patch
+    bool has_male() const { return male_ != no_handle; }
 
-    //! \brief Returns an pointer to the breeding male
-    //! If the returned pointer is nullptr, no breeding male
+    //! \brief Returns the handle of the breeding male
+    //! If the returned handle is no_handle, no breeding male
     //! exist on the patch.
-    Individual* male() { return male_.empty() ? nullptr : &*male_.begin(); }
+    handle_t male() const { return male_; }
 
     //! \brief Sets new male
     //! \param newMale The new male
-    void set_male(Individual const& newMale) { male_.assign(1, newMale); }
+    void set_male(handle_t newMale) { male_ = newMale; }
 
-    //! \brief Returns the breeder collection. 
-    container_t const& breeder() const { return breeder_; }
-
-    //! \brief Returns an iterator to the first breeder_
-    //! If the returned iterator is equal to cend(), the patch
-    //! is empty.
-    container_t& breeder() { return breeder_; }
-
-    //! \brief Returns the rank vector of the female offspring
-    std::vector<xynR_type> const& verdict() const { return verdict_; }
+    //! \brief Returns the breeders, dominant first
+    handle_span breeder() const { return { breeder_, n_ }; }
 
     //! brief Handles survival on the patch
     //! \param param parameter set
-    void do_survival(Parameter const& param);
+    //! \param store the individuals
+    void do_survival(Parameter const& param, IndividualStore const& store);
 
     //! \brief Handles reproduction on patch
     //! \tparam MODE Mode
+    //! \tparam OVOTE offspring vote, x is only computed if needed
+    //! \tparam BVOTE breeder vote, y is only computed if needed
     //! \param param parameter set
+    //! \param store the individuals
     //! \param male_floater male floater pool
-    template <Mating MODE>
-    void do_reproduction(Parameter const& param, container_t const& male_floater);
+    //! \param block reserved slots for the offspring, at least F0 per breeder
+    //! \param scratch receives the offspring
+    template <Mating MODE, oVote OVOTE, bVote BVOTE>
+    void do_reproduction(Parameter const& param, IndividualStore& store, container_t const& male_floater, StoreBlock& block, patch_scratch& scratch);
 
     //! \brief Handles dispersal on patch and to the floater pool
     //! \tparam PLACEMENT oPlacemanet
-    //! \param param parameter set
+    //! \tparam OVOTE offspring vote
+    //! \tparam BVOTE breeder vote
     //! \param female_floater the female floater pool
     //! \param male_floater the male floater pool
-    template <oPlacement PLACEMENT>
-    void do_dispersal(Parameter const& param, container_t& female_floater, container_t& male_floater);
+    //! \param scratch the offspring from do_reproduction, consumed
+    //! \param verdicts receives the outcome of the poll
+    //! \param index index of this patch, tags the poll
+    template <oPlacement PLACEMENT, oVote OVOTE, bVote BVOTE>
+    void do_dispersal(container_t& female_floater, container_t& male_floater, patch_scratch& scratch, verdict_table& verdicts, size_t index);
 
     //! \brief Handles colonization of the patch by female floater
     //! \param param parameter set
     //! \param floater The female floater
-    void do_colonization(Parameter const& param, Individual const& floater);
+    //!
+    //! Requires at least one attached slot.
+    void do_colonization(Parameter const& param, handle_t floater);
 
   private:
-    void prepare_reproduction();
-    void create_offsprings(Parameter const& param, Individual const& male);
-    void disperse_males_and_poll(container_t& male_floater);
+    void push_breeder(handle_t h);
+    template <Mating MODE> handle_t sire(container_t const& male_floater) const;
+    template <oVote OVOTE, bVote BVOTE> void create_offsprings(Parameter const& param, IndividualStore& store, handle_t male, StoreBlock& block, patch_scratch& scratch);
+    template <oVote OVOTE, bVote BVOTE> void disperse_males_and_poll(container_t& male_floater, patch_scratch const& scratch, verdict_table& verdicts, size_t index);
+    template <oPlacement PLACEMENT> void place_daughters(container_t& female_floater, patch_scratch& scratch, xynR_type const* verdict);
 
     // voting system
-    template <oVote V> double offspring_vote(size_t ioffs) const;
-    template <bVote V> double breeder_vote(size_t ioffs) const;
-
-    container_t breeder_;
-    container_t female_offspring_;
-    container_t male_offspring_;
-    container_t male_;
-    std::vector<double> x_;             // offspring stay prob
-    std::vector<double> y_;             // mothers accept prob
-    std::vector<unsigned> R_;           // rank of mother == position of mother + 1
-    std::vector<xynR_type> verdict_;    // the outcome of the poll x,y,n,R
+    template <bVote V> void accept_probabilities(IndividualStore const& store, Math math, patch_scratch& scratch) const;
+    template <oVote V> double offspring_vote(patch_scratch const& scratch, size_t ioffs) const;
+    template <bVote V> double breeder_vote(patch_scratch const& scratch, size_t ioffs) const;
+
+    handle_t* breeder_ = nullptr;       // slice in the breeder array
+    size_t n_ = 0;                      // number of breeders
+    size_t capacity_ = 0;               // size of the slice
+    handle_t male_ = no_handle;
   };
 
 }
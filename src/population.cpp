@@ -3,22 +3,140 @@
 */
 
 #include <algorithm>
+#include <stdexcept>
+#include <cassert>
 #include "population.h"
+#include "survival.h"
 
 
 namespace npm {
 
 
   Population::Population(Parameter const& param)
+  : store_(param)
   {
     auto M = static_cast<size_t>(std::ceil((param.m0 * param.m / 100.0)));
     auto Default = Individual(param);
+    const bool resident = (param.mode == Mating::MATING_RESIDENCY);
+    store_.resize((resident ? 2 * M : M) + param.nmf);
+    patches_.resize(param.m);
+    layout_patches(param);
+    handle_t h = 0;
     for (size_t i = 0; i < M; ++i) 
     {
-      patches_.emplace_back(Default, (param.mode==Mating::MATING_RESIDENCY ? &Default : nullptr));
+      store_.set(h, Default);
+      occupy(i);
+      patches_[i].do_colonization(param, h);
+      if (resident) 
+      {
+        store_.set(h + 1, Default);
+        patches_[i].set_male(h + 1);
+      }
+      h += resident ? 2 : 1;
+    }
+    update_occupied();
+    for (size_t i=0; i < param.nmf; ++i, ++h) 
+    {
+      store_.set(h, Default);
+      male_floater_.push_back(h);
+    }
+  }
+
+
+  void Population::layout_patches(Parameter const& param)
+  {
+    const size_t F0 = param.F0;
+    walkin_capacity_ = 1 + F0;
+    size_t total = (patches_.size() - occupied_.size()) * walkin_capacity_;
+    for (auto i : occupied_) total += std::max<size_t>(patches_[i].size(), 1) * (1 + F0);
+    spare_breeders_.resize(total);
+    handle_t* first = spare_breeders_.data();
+    for (auto i : occupied_)
+    {
+      const size_t capacity = std::max<size_t>(patches_[i].size(), 1) * (1 + F0);
+      patches_[i].attach(first, capacity);
+      first += capacity;
+    }
+    walkin_ = first;
+    breeders_.swap(spare_breeders_);
+  }
+
+
+  // a vacant patch gets the next walk-in slots,
+  // its index goes to occupied_ with the next update_occupied()
+  void Population::occupy(size_t i)
+  {
+    auto& patch = patches_[i];
+    if (patch.attached()) return;
+    assert(walkin_ + walkin_capacity_ <= breeders_.data() + breeders_.size());
+    patch.attach(walkin_, walkin_capacity_);
+    walkin_ += walkin_capacity_;
+    newcomers_.push_back(i);
+  }
+
+
+  void Population::update_occupied()
+  {
+    auto last = std::remove_if(occupied_.begin(), occupied_.end(), [this](size_t i)
+    {
+      auto& patch = patches_[i];
+      if (!patch.empty() || patch.has_male()) return false;
+      patch.detach();
+      return true;
+    });
+    occupied_.erase(last, occupied_.end());
+    if (!newcomers_.empty())
+    {
+      const auto mid = static_cast<std::ptrdiff_t>(occupied_.size());
+      std::sort(newcomers_.begin(), newcomers_.end());
+      occupied_.insert(occupied_.end(), newcomers_.cbegin(), newcomers_.cend());
+      std::inplace_merge(occupied_.begin(), occupied_.begin() + mid, occupied_.end());
+      newcomers_.clear();
+    }
+  }
+
+
+  void Population::reserve_offspring(Parameter const& param, std::vector<size_t> const& bounds, std::vector<StoreBlock>& blocks)
+  {
+    const size_t F0 = param.F0;
+    size_t total = 0;
+    for (size_t j = bounds.front(); j < bounds.back(); ++j) total += F0 * patches_[occupied_[j]].size();
+    const size_t recycled = std::min(total, free_.size());
+    const size_t fresh = total - recycled;
+    if (store_.size() + fresh >= no_handle) throw std::runtime_error("Individual store overflow");
+    reserved_.assign(free_.rbegin(), free_.rbegin() + recycled);
+    free_.resize(free_.size() - recycled);
+    for (size_t j = 0; j < fresh; ++j) reserved_.push_back(static_cast<handle_t>(store_.size() + j));
+    store_.resize(store_.size() + fresh);
+    blocks.resize(bounds.size() - 1);
+    handle_t const* next = reserved_.data();
+    for (size_t c = 0; c < blocks.size(); ++c)
+    {
+      size_t n = 0;
+      for (size_t j = bounds[c]; j < bounds[c + 1]; ++j) n += patches_[occupied_[j]].size();
+      blocks[c] = { next, next + F0 * n };
+      next += F0 * n;
+    }
+  }
+
+
+  void Population::collect_garbage()
+  {
+    alive_.assign(store_.size(), 0);
+    auto mark = [this](auto const& c) { for (auto h : c) alive_[h] = 1; };
+    for (auto i : occupied_)
+    {
+      auto const& patch = patches_[i];
+      mark(patch.breeder());
+      if (patch.has_male()) alive_[patch.male()] = 1;
+    }
+    mark(female_floater_);
+    mark(male_floater_);
+    free_.clear();
+    for (size_t h = store_.size(); h > 0; --h)
+    {
+      if (!alive_[h - 1]) free_.push_back(static_cast<handle_t>(h - 1));
     }
-    for (size_t i = M; i < param.m; ++i) patches_.emplace_back();
-    for (size_t i=0; i < param.nmf; ++i) male_floater_.emplace_back(Default);
   }
 
 
@@ -31,16 +149,9 @@ namespace npm {
 
   void Population::do_floater_survival(Parameter const& param)
   {
-    std::bernoulli_distribution bernoulli_Sff(1.0 - param.Sff);
-    female_floater_.erase(std::remove_if(female_floater_.begin(), female_floater_.end(), [&bernoulli_Sff](Individual&)
-    {
-      return bernoulli_Sff(RndEng);
-    }), female_floater_.end());
-    std::bernoulli_distribution bernoulli_Smf(1.0 - param.Smf);
-    male_floater_.erase(std::remove_if(male_floater_.begin(),male_floater_.end(),[&bernoulli_Smf](Individual&)
-    {
-      return bernoulli_Smf(RndEng);
-    }),male_floater_.end());
+    auto none = [](handle_t) { return false; };
+    female_floater_.erase(survival_sweep(female_floater_.begin(), female_floater_.end(), 1.0 - param.Sff, none, RndEng), female_floater_.end());
+    male_floater_.erase(survival_sweep(male_floater_.begin(), male_floater_.end(), 1.0 - param.Smf, none, RndEng), male_floater_.end());
   }
 
 
@@ -50,13 +161,14 @@ namespace npm {
     TakeoverStats tc{0, 0, 0};
     if (female_floater_.empty()) return tc;
     std::poisson_distribution<> rndPois(param.eps * female_floater_.size());
-    for (auto& patch : patches_)
+    for (size_t i = 0; i < patches_.size(); ++i)
     {
       if (female_floater_.empty()) return tc;
       int k = rndPois(RndEng);
       tc.attempt += k;
       if (k)
       {
+        auto& patch = patches_[i];
         bool takeover = false;
         if (patch.empty())
         {
@@ -66,10 +178,11 @@ namespace npm {
         else
         {
           double tprob = static_cast<double>(k) * param.t0 * std::exp(-param.tau * (patch.size() - 1));
-          takeover = std::bernoulli_distribution(tprob)(RndEng);
+          takeover = rndutils::bernoulli_trial(RndEng, rndutils::bernoulli_threshold(tprob));
         }
         if (takeover)
         {
+          occupy(i);
           patch.do_colonization(param, female_floater_.back());
           female_floater_.pop_back();
           ++tc.takeover;
@@ -84,15 +197,255 @@ namespace npm {
   TakeoverStats Population::do_colonization<Mating::MATING_RESIDENCY>(Parameter const& param)
   {
     auto tc = do_colonization<Mating::MATING_RANDOM>(param);  // same for females
-    for (auto& patch : patches_)
+    do_male_settlement();
+    return tc;
+  }
+
+
+  // males settle on patches without male in patch order
+  void Population::do_male_settlement()
+  {
+    for (size_t i = 0; i < patches_.size(); ++i)
     {
-      if (male_floater_.empty()) return tc;
-      if (nullptr == patch.male())
+      if (male_floater_.empty()) return;
+      auto& patch = patches_[i];
+      if (!patch.has_male())
       {
+        occupy(i);
         patch.set_male(male_floater_.back());
         male_floater_.pop_back();
       }
     }
+  }
+
+
+  // The attempts of all patches are one Poisson(m eps F) sample,
+  // each assigned to a uniform random patch. Thus the attempts per
+  // patch are iid Poisson(eps F), as in the serial version, which
+  // visits the searched patches in the same order and stops as
+  // soon as the floater pool runs dry.
+  TakeoverStats Population::do_female_colonization_sparse(Parameter const& param)
+  {
+    TakeoverStats tc{0, 0, 0};
+    if (female_floater_.empty() || patches_.empty()) return tc;
+    const double mean = param.eps * static_cast<double>(female_floater_.size()) * static_cast<double>(patches_.size());
+    const size_t K = std::poisson_distribution<size_t>(mean)(RndEng);
+    rndutils::uniform_signed_distribution<int> rndPatch(0, static_cast<int>(patches_.size()) - 1);
+    // k attempts on patch i, false if the floater pool ran dry
+    auto search = [&](size_t i, size_t k)
+    {
+      if (female_floater_.empty()) return false;
+      tc.attempt += k;
+      auto& patch = patches_[i];
+      bool takeover = false;
+      if (patch.empty())
+      {
+        ++tc.walkin;
+        takeover = true;
+      }
+      else
+      {
+        double tprob = static_cast<double>(k) * param.t0 * std::exp(-param.tau * (patch.size() - 1));
+        takeover = rndutils::bernoulli_trial(RndEng, rndutils::bernoulli_threshold(tprob));
+      }
+      if (takeover)
+      {
+        occupy(i);
+        patch.do_colonization(param, female_floater_.back());
+        female_floater_.pop_back();
+        ++tc.takeover;
+      }
+      return true;
+    };
+    if (K < patches_.size() / 16)
+    { // sparse: sorted patch indices
+      touched_.resize(K);
+      for (auto& i : touched_) i = static_cast<size_t>(rndPatch(RndEng));
+      std::sort(touched_.begin(), touched_.end());
+      for (size_t j = 0; j < K;)
+      {
+        const size_t i = touched_[j];
+        const size_t first = j;
+        for (; j < K && touched_[j] == i; ++j);
+        if (!search(i, j - first)) break;
+      }
+    }
+    else
+    { // dense: counting sort, same outcome
+      attempts_.assign(patches_.size(), 0);
+      for (size_t j = 0; j < K; ++j) ++attempts_[rndPatch(RndEng)];
+      for (size_t i = 0; i < patches_.size(); ++i)
+      {
+        if (attempts_[i] && !search(i, attempts_[i])) break;
+      }
+    }
+    return tc;
+  }
+
+
+  template <>
+  TakeoverStats Population::do_colonization_sparse<Mating::MATING_RANDOM>(Parameter const& param)
+  {
+    return do_female_colonization_sparse(param);
+  }
+
+
+  template <>
+  TakeoverStats Population::do_colonization_sparse<Mating::MATING_RESIDENCY>(Parameter const& param)
+  {
+    auto tc = do_female_colonization_sparse(param);  // same for females
+    do_male_settlement();
+    return tc;
+  }
+
+
+  TakeoverStats Population::colonization_stats(Parameter const& param) const
+  {
+    TakeoverStats tc{0, 0, 0};
+    size_t floater = female_floater_.size();
+    if (floater == 0) return tc;
+    std::poisson_distribution<> rndPois(param.eps * floater);
+    for (auto const& patch : patches_)
+    {
+      if (floater == 0) return tc;
+      int k = rndPois(RndEng);
+      tc.attempt += k;
+      if (k)
+      {
+        bool takeover = false;
+        if (patch.empty())
+        {
+          ++tc.walkin;
+          takeover = true;
+        }
+        else
+        {
+          double tprob = static_cast<double>(k) * param.t0 * std::exp(-param.tau * (patch.size() - 1));
+          takeover = rndutils::bernoulli_trial(RndEng, rndutils::bernoulli_threshold(tprob));
+        }
+        if (takeover)
+        {
+          --floater;
+          ++tc.takeover;
+        }
+      }
+    }
+    return tc;
+  }
+
+
+  // Three passes: 
+  // 1. the shards run the search on their patches in parallel
+  // 2. the floaters are handed out to the successful searches in patch order,
+  //    until the floater pool runs dry. Same order as the serial version.
+  // 3. the shards apply the colonizations in parallel
+  TakeoverStats Population::do_female_colonization_sharded(Parameter const& param, thread_pool& pool, size_t tick)
+  {
+    TakeoverStats tc{0, 0, 0};
+    const size_t F = female_floater_.size();
+    if (F == 0) return tc;
+    const size_t S = num_shards();
+    search_records_.resize(S);
+    const std::poisson_distribution<> rndPois(param.eps * F);
+    const auto master = RndEng;     // the calling thread takes part
+    pool.parallel_for(S, [&](size_t s)
+    {
+      seed_stream(param, tick, Stream::STREAM_COLONIZATION | s);
+      auto& records = search_records_[s];
+      records.clear();
+      auto pois = rndPois;
+      const size_t last = std::min(patches_.size(), (s + 1) * shard_size);
+      for (size_t i = s * shard_size; i < last; ++i)
+      {
+        size_t k = pois(RndEng);
+        if (k)
+        {
+          auto const& patch = patches_[i];
+          bool takeover = patch.empty();
+          if (!takeover)
+          {
+            double tprob = static_cast<double>(k) * param.t0 * std::exp(-param.tau * (patch.size() - 1));
+            takeover = rndutils::bernoulli_trial(RndEng, rndutils::bernoulli_threshold(tprob));
+          }
+          records.push_back({ i, k, npos, takeover });
+        }
+      }
+    });
+    RndEng = master;
+    size_t j = 0;
+    for (auto& records : search_records_)
+    {
+      for (auto& rec : records)
+      {
+        if (j == F) break;
+        tc.attempt += rec.attempts;
+        if (patches_[rec.patch].empty()) ++tc.walkin;
+        if (rec.takeover)
+        {
+          rec.floater = F - ++j;
+          occupy(rec.patch);
+        }
+      }
+    }
+    tc.takeover = j;
+    pool.parallel_for(S, [&](size_t s)
+    {
+      for (auto const& rec : search_records_[s])
+      {
+        if (rec.floater == npos) continue;
+        patches_[rec.patch].do_colonization(param, female_floater_[rec.floater]);
+      }
+    });
+    female_floater_.resize(F - j);
+    return tc;
+  }
+
+
+  // males settle on patches without male in patch order
+  void Population::do_male_settlement_sharded(thread_pool& pool)
+  {
+    const size_t F = male_floater_.size();
+    if (F == 0) return;
+    const size_t S = num_shards();
+    maleless_.resize(S);
+    pool.parallel_for(S, [&](size_t s)
+    {
+      maleless_[s].clear();
+      const size_t last = std::min(patches_.size(), (s + 1) * shard_size);
+      for (size_t i = s * shard_size; i < last; ++i)
+      {
+        if (!patches_[i].has_male()) maleless_[s].push_back(i);
+      }
+    });
+    std::vector<size_t> first(S + 1, 0);    // first floater per shard, counted from the back
+    for (size_t s = 0; s < S; ++s) first[s + 1] = first[s] + maleless_[s].size();
+    pool.parallel_for(S, [&](size_t s)
+    {
+      for (size_t j = first[s]; j < std::min(first[s + 1], F); ++j)
+      {
+        patches_[maleless_[s][j - first[s]]].set_male(male_floater_[F - 1 - j]);
+      }
+    });
+    for (size_t s = 0; s < S; ++s)
+    {
+      for (size_t j = first[s]; j < std::min(first[s + 1], F); ++j) occupy(maleless_[s][j - first[s]]);
+    }
+    male_floater_.resize(F - std::min(first[S], F));
+  }
+
+
+  template <>
+  TakeoverStats Population::do_colonization_sharded<Mating::MATING_RANDOM>(Parameter const& param, thread_pool& pool, size_t tick)
+  {
+    return do_female_colonization_sharded(param, pool, tick);
+  }
+
+
+  template <>
+  TakeoverStats Population::do_colonization_sharded<Mating::MATING_RESIDENCY>(Parameter const& param, thread_pool& pool, size_t tick)
+  {
+    auto tc = do_female_colonization_sharded(param, pool, tick);  // same for females
+    do_male_settlement_sharded(pool);
     return tc;
   }
 
@@ -7,6 +7,7 @@
 #define NPM_POPULATION_H_INCLUDED
 
 #include "patch.h"
+#include "thread_pool.h"
 
 
 namespace npm{
@@ -15,12 +16,21 @@ namespace npm{
   //! \brief The population
   //!
   //! A Population consists of its patches and the floater pool.
+  //! The individuals live in the IndividualStore of the population,
+  //! patches and floater pools hold handles into it.
+  //! The breeders of all patches are kept in one array, patch by patch.
+  //! The population keeps an index of the occupied patches, the
+  //! vacant ones have nothing to do in a tick.
   class Population
   {
   public:
     //! creates a empty population
     Population() = default;
 
+    // patches point into breeders_
+    Population(Population const&) = delete;
+    Population& operator=(Population const&) = delete;
+
     //! \brief creates the initial population
     //! \param param parameter set
     //!
@@ -34,6 +44,20 @@ namespace npm{
     //! Returns the patches, non const
     std::vector<Patch>& patches() { return patches_; }
 
+    //! \brief Returns the indices of the occupied patches, ascending
+    //!
+    //! A patch is occupied if it holds breeders or a male, the vacant
+    //! patches neither reproduce, disperse nor die. Up to date after
+    //! update_occupied(), the patches that run vacant in a tick stay in
+    //! there until then.
+    std::vector<size_t> const& occupied() const { return occupied_; }
+
+    //! \brief Updates occupied() after the colonization
+    //!
+    //! Drops the patches that ran vacant, they lose their slots, and
+    //! merges in the patches settled by the colonization.
+    void update_occupied();
+
     //! Returns the female floaters
     container_t const& female_floater() const { return female_floater_; }
 
@@ -46,6 +70,44 @@ namespace npm{
     //! Returns the male floaters, non const
     container_t& male_floater() { return male_floater_; }
 
+    //! Returns the individuals
+    IndividualStore const& store() const { return store_; }
+
+    //! Returns the individuals, non const
+    IndividualStore& store() { return store_; }
+
+    //! \brief Rebuilds the breeder array
+    //! \param param parameter set
+    //!
+    //! Packs the breeders of the occupied patches patch after patch
+    //! into a fresh array. Every occupied patch gets room for its
+    //! breeders, at least one, plus F0 offspring per breeder, enough
+    //! for the next tick. The vacant patches stay detached, the
+    //! colonization attaches them to the walk-in slots at the end of
+    //! the array on demand.
+    void layout_patches(Parameter const& param);
+
+    //! \brief Reserves store slots for the offspring of consecutive patch ranges
+    //! \param param parameter set
+    //! \param bounds boundaries of the patch ranges into occupied()
+    //! \param blocks receives the reserved blocks, one per range
+    //!
+    //! A patch produces at most F0 offspring per breeder.
+    //! The slots are taken from the free list first, the store grows
+    //! only if the free list runs dry. Reserved slots that are not used
+    //! return to the free list with the next collect_garbage().
+    void reserve_offspring(Parameter const& param, std::vector<size_t> const& bounds, std::vector<StoreBlock>& blocks);
+
+    //! \brief Rebuilds the free list from the slots of the dead
+    //!
+    //! Individuals die by mortality, by floater mortality and by
+    //! takeover. Instead of tracking every one of them, the live
+    //! handles are marked and the free list is swept once per tick.
+    void collect_garbage();
+
+    //! \brief Increments the age of every individual
+    void increment_age() { store_.increment_age(); }
+
     //! \brief Random shuffle of floaters
     void shuffle_floater(Parameter const& param);
 
@@ -60,6 +122,37 @@ namespace npm{
     template <Mating MODE>
     TakeoverStats do_colonization(Parameter const& param);
 
+    //! \brief Handles colonization and takeover in parallel
+    //! \tparam MODE Mode::RANDOM_MATING or Mode::MALE_RESIDENCY
+    //! \param param parameter set
+    //! \param pool the thread pool
+    //! \param tick current time tick
+    //! \returns { number of takeover attempts, number of takeovers }
+    //!
+    //! Same model as do_colonization but the patches are processed in
+    //! shards of fixed size, each with its own random stream.
+    template <Mating MODE>
+    TakeoverStats do_colonization_sharded(Parameter const& param, thread_pool& pool, size_t tick);
+
+    //! \brief Handles colonization and takeover, visits the searched patches only
+    //! \tparam MODE Mode::RANDOM_MATING or Mode::MALE_RESIDENCY
+    //! \param param parameter set
+    //! \returns { number of takeover attempts, number of takeovers }
+    //!
+    //! Same model as do_colonization but draws the total number of
+    //! attempts, Poisson(m eps F), and spreads them uniformly over the
+    //! patches. This gives the same iid Poisson(eps F) attempts per
+    //! patch at O(attempts) instead of O(m) cost.
+    template <Mating MODE>
+    TakeoverStats do_colonization_sparse(Parameter const& param);
+
+    //! \brief Takeover statistics of the serial colonization
+    //! \param param parameter set
+    //! \returns { number of takeover attempts, number of takeovers }
+    //!
+    //! Dry run of do_colonization<MATING_RANDOM>, the population stays untouched.
+    TakeoverStats colonization_stats(Parameter const& param) const;
+
     //! \brief
     //! \param fun a function object with the signature void fun(Individual const&);
     //!
@@ -88,9 +181,41 @@ namespace npm{
 
 
   private:
+    // outcome of the search on a patch with at least one attempt
+    struct search_record
+    {
+      size_t patch;       // patch index
+      size_t attempts;    // number of attempts
+      size_t floater;     // index of the colonizing floater, npos if none
+      bool takeover;      // successful attempt
+    };
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr size_t shard_size = 1024;
+    size_t num_shards() const { return (patches_.size() + shard_size - 1) / shard_size; }
+    TakeoverStats do_female_colonization_sharded(Parameter const& param, thread_pool& pool, size_t tick);
+    void do_male_settlement_sharded(thread_pool& pool);
+    TakeoverStats do_female_colonization_sparse(Parameter const& param);
+    void do_male_settlement();
+    void occupy(size_t i);
+
+    IndividualStore store_;
     std::vector<Patch> patches_;
+    std::vector<size_t> occupied_;                            // patches with breeders or male, ascending
+    std::vector<size_t> newcomers_;                           // patches occupied since the last update_occupied
+    std::vector<handle_t> breeders_;                          // breeder slots of all patches
+    std::vector<handle_t> spare_breeders_;                    // layout_patches target
+    handle_t* walkin_ = nullptr;                              // next walk-in slots in breeders_
+    size_t walkin_capacity_ = 0;                              // slots per walk-in
     container_t female_floater_;
     container_t male_floater_;
+    std::vector<handle_t> free_;                              // free slots, descending
+    std::vector<handle_t> reserved_;                          // slots reserved by reserve_offspring
+    std::vector<char> alive_;                                 // collect_garbage marks
+    std::vector<std::vector<search_record>> search_records_;  // per shard
+    std::vector<std::vector<size_t>> maleless_;               // per shard
+    std::vector<size_t> touched_;                             // patch per attempt, do_female_colonization_sparse
+    std::vector<unsigned> attempts_;                          // attempts per patch, do_female_colonization_sparse
   };
 
   
@@ -107,6 +232,22 @@ namespace npm{
   TakeoverStats Population::do_colonization<Mating::MATING_RESIDENCY>(Parameter const& param);
 
 
+  template <>
+  TakeoverStats Population::do_colonization_sharded<Mating::MATING_RANDOM>(Parameter const& param, thread_pool& pool, size_t tick);
+
+
+  template <>
+  TakeoverStats Population::do_colonization_sharded<Mating::MATING_RESIDENCY>(Parameter const& param, thread_pool& pool, size_t tick);
+
+
+  template <>
+  TakeoverStats Population::do_colonization_sparse<Mating::MATING_RANDOM>(Parameter const& param);
+
+
+  template <>
+  TakeoverStats Population::do_colonization_sparse<Mating::MATING_RESIDENCY>(Parameter const& param);
+
+
   //
   // implementation of template member functions
   //
@@ -114,22 +255,23 @@ namespace npm{
   template <typename UnaryFunction>
   inline void Population::visit_all(UnaryFunction fun)
   {
-    for (auto& patch : patches_)
+    for (auto i : occupied_)
     {
-      for (auto& ind : patch.breeder()) fun(ind);
-      if (patch.male()) fun(*patch.male());
+      auto const& patch = patches_[i];
+      for (auto h : patch.breeder()) fun(store_.get(h));
+      if (patch.has_male()) fun(store_.get(patch.male()));
     }
-    for(auto& ind : female_floater_) fun(ind);
-    for(auto& ind : male_floater_) fun(ind);
+    for(auto h : female_floater_) fun(store_.get(h));
+    for(auto h : male_floater_) fun(store_.get(h));
   }
 
 
   template <typename UnaryFunction>
   inline void Population::visit_breeder(UnaryFunction fun)
   {
-    for (auto& patch : patches_)
+    for (auto i : occupied_)
     {
-      for (auto& ind : patch.breeder()) fun(ind);
+      for (auto h : patches_[i].breeder()) fun(store_.get(h));
     }
   }
 
@@ -137,11 +279,11 @@ namespace npm{
   template <typename UnaryFunction>
   inline void Population::visit_patches(UnaryFunction fun)
   {
-    for (auto const& patch : patches_)
+    for (auto i : occupied_)
     {
-      if (!patch.empty())
+      if (!patches_[i].empty())
       {
-        fun(patch);
+        fun(patches_[i]);
       }
     }
   }
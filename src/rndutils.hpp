@@ -375,6 +375,15 @@ public:
     for (auto& s : state_) s = mtd(mt);
   }
 
+  // sets the state directly, no std::seed_seq involved.
+  // Intended for short-lived streams derived from a
+  // counter-based generator, e.g. one stream per task.
+  void seed(uint64_t s0, uint64_t s1) noexcept
+  {
+    state_[0] = (s0 | s1) ? s0 : default_seed;   // all-zero state is invalid
+    state_[1] = s1;
+  }
+
   uint64_t operator()(void) noexcept
   {
     uint64_t s0 = state_[0];
@@ -501,6 +510,113 @@ private:
 };
 
 
+// Philox4x32-10 counter-based random number generator.
+// Salmon et al. 2011, Parallel random numbers: as easy as 1, 2, 3.
+// The output is a bijection of the 128bit counter, keyed by a 64bit key.
+// Thus, every (key, counter) pair yields an independent random block
+// in constant time - ideal to derive random streams for tasks from
+// e.g. (seed, repetition, time, index). Slower than xorshift128 as
+// a sequential generator.
+class philox4x32
+{
+public:
+  using result_type = uint64_t;
+  using engine_type = philox4x32;
+  using ctr_type = std::array<uint32_t, 4>;
+  using key_type = std::array<uint32_t, 2>;
+
+  static constexpr uint64_t default_seed = static_cast<uint64_t>(0x8f4e5b8d2b1a6c37);
+  static constexpr uint64_t (min)() { return 0ull; };
+  static constexpr uint64_t (max)() { return std::numeric_limits<uint64_t>::max(); };
+
+  explicit philox4x32(uint64_t key = default_seed, ctr_type const& ctr = ctr_type{})
+  {
+    seed(key, ctr);
+  }
+
+  void seed(uint64_t key = default_seed, ctr_type const& ctr = ctr_type{})
+  {
+    key_ = { { static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32u) } };
+    ctr_ = ctr;
+    idx_ = 2;
+  }
+
+  // the random block for counter ctr and key key. 
+  static ctr_type block(ctr_type ctr, key_type key) noexcept
+  {
+    for (int r = 0; r < 10; ++r)
+    {
+      const uint64_t p0 = static_cast<uint64_t>(0xD2511F53) * ctr[0];
+      const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57) * ctr[2];
+      ctr = { { static_cast<uint32_t>(p1 >> 32u) ^ ctr[1] ^ key[0], static_cast<uint32_t>(p1),
+                static_cast<uint32_t>(p0 >> 32u) ^ ctr[3] ^ key[1], static_cast<uint32_t>(p0) } };
+      key[0] += static_cast<uint32_t>(0x9E3779B9);
+      key[1] += static_cast<uint32_t>(0xBB67AE85);
+    }
+    return ctr;
+  }
+
+  // the random block for counter ctr and 64bit key.
+  static ctr_type block(ctr_type const& ctr, uint64_t key) noexcept
+  {
+    return block(ctr, key_type{ { static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32u) } });
+  }
+
+  uint64_t operator()(void) noexcept
+  {
+    if (idx_ == 2)
+    {
+      buf_ = block(ctr_, key_);
+      for (auto& c : ctr_) if (++c) break;    // 128bit increment
+      idx_ = 0;
+    }
+    const auto i = 2 * idx_++;
+    return (static_cast<uint64_t>(buf_[i + 1]) << 32u) | buf_[i];
+  }
+
+  void discard(unsigned long long z) noexcept
+  {
+    for (unsigned long long i = 0; i < z; ++i) this->operator()();
+  }
+
+  friend bool operator==(engine_type const& lhs, engine_type const& rhs) noexcept
+  {
+    return lhs.key_ == rhs.key_ && lhs.ctr_ == rhs.ctr_ && lhs.idx_ == rhs.idx_ && (lhs.idx_ == 2 || lhs.buf_ == rhs.buf_);
+  }
+
+  friend bool operator!=(engine_type const& lhs, engine_type const& rhs) noexcept
+  {
+    return !(lhs == rhs);
+  }
+
+  template <class CharT, class Traits>
+  friend auto operator<<(std::basic_ostream<CharT, Traits>& os, engine_type const& reng) -> std::basic_ostream<CharT, Traits>&
+  {
+    for (auto x : reng.key_) os << x << ' ';
+    for (auto x : reng.ctr_) os << x << ' ';
+    for (auto x : reng.buf_) os << x << ' ';
+    os << reng.idx_ << ' ';
+    return os;
+  }
+
+  template <class CharT, class Traits>
+  friend auto operator>>(std::basic_istream<CharT, Traits>& is, engine_type& reng) -> std::basic_istream<CharT, Traits>&
+  {
+    for (auto& x : reng.key_) is >> x >> std::ws;
+    for (auto& x : reng.ctr_) is >> x >> std::ws;
+    for (auto& x : reng.buf_) is >> x >> std::ws;
+    is >> reng.idx_ >> std::ws;
+    return is;
+  }
+
+private:
+  key_type key_;
+  ctr_type ctr_;
+  ctr_type buf_ = {};
+  int idx_ = 2;
+};
+
+
 //
 // Seeding support
 //
@@ -896,6 +1012,25 @@ private:
 };
 
 
+// Bernoulli trial as one integer compare against the raw engine output.
+// The probability is converted once into a 63 bit threshold,
+// resolution 2^-63, p <= 0 never and p >= 1 always succeeds.
+// Takes one 64 bit engine call per trial, like std::bernoulli_distribution.
+inline uint64_t bernoulli_threshold(double p) noexcept
+{
+  constexpr uint64_t one = uint64_t(1) << 63u;
+  return (p > 0.0) ? ((p < 1.0) ? static_cast<uint64_t>(p * 0x1p63) : one) : 0;
+}
+
+
+template <typename URNG>
+inline bool bernoulli_trial(URNG& reng, uint64_t threshold)
+{
+  static_assert(detail::urng_range<URNG>::digits == 64 && URNG::min() == 0, "bernoulli_trial requires a full range 64 bit engine");
+  return (static_cast<uint64_t>(reng()) >> 1u) < threshold;
+}
+
+
 // binomial distribution with p=0.5.
 // direct pop-count sampling, potentially very fast for small n, up to n~10000. 
 template <
@@ -1255,6 +1390,27 @@ void generate_uniform_n(size_t n, URNG& reng, OIt out)
 }
 
 
+// n Bernoulli trials against bernoulli_threshold()s: out[i] = trial(threshold[i]).
+// The engine words are drawn into a block first, the compares vectorize.
+// out may alias threshold.
+template <typename OutT, typename URNG>
+void generate_bernoulli_n(size_t n, uint64_t const* threshold, URNG& reng, OutT* out)
+{
+  static_assert(detail::urng_range<URNG>::digits == 64 && URNG::min() == 0, "generate_bernoulli_n requires a full range 64 bit engine");
+  constexpr size_t block = 64;
+  uint64_t x[block];
+  for (size_t i = 0; i < n; i += block) {
+    const size_t m = std::min(block, n - i);
+    for (size_t j = 0; j < m; ++j) {
+      x[j] = static_cast<uint64_t>(reng()) >> 1u;
+    }
+    for (size_t j = 0; j < m; ++j) {
+      out[i + j] = static_cast<OutT>(x[j] < threshold[i + j]);
+    }
+  }
+}
+
+
 template <typename RndIt, typename URNG>
 inline void shuffle(RndIt first, RndIt last, URNG&& reng)
 {
@@ -1386,6 +1542,7 @@ private:
 namespace std {
   RNDUTILS_FAST_GENERATE_CANONICAL(rndutils::xorshift128)
   RNDUTILS_FAST_GENERATE_CANONICAL(rndutils::xorshift1024)
+  RNDUTILS_FAST_GENERATE_CANONICAL(rndutils::philox4x32)
 }
 #endif
 
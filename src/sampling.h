@@ -0,0 +1,130 @@
+/*! \file sampling.h
+* \brief Batched samplers for the sweep kernels
+*
+*/
+
+#ifndef NPM_SAMPLING_H_INCLUDED
+#define NPM_SAMPLING_H_INCLUDED
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <random>
+
+
+namespace npm {
+
+
+  //! \brief Largest batch of the samplers
+  constexpr size_t sample_batch = 64;
+
+
+  //! \brief Uniform variate in (0, 1] from the upper 53 bits of one draw
+  //!
+  //! Never zero, safe to take the logarithm. Needs a 64 bit engine.
+  template <typename URNG>
+  inline double uniform53(URNG& reng)
+  {
+    static_assert(URNG::max() == UINT64_MAX && URNG::min() == 0, "uniform53: 64 bit engine required");
+    return static_cast<double>((reng() >> 11) + 1) * 0x1p-53;
+  }
+
+
+  //! \brief Geometric distribution, failures before the first success
+  //!
+  //! Inversion of uniform53 variates, drawn in batches. Replaces
+  //! rndutils::iota_gap_sampler in the sweeps: it wraps
+  //! std::geometric_distribution, which is slower than the Bernoulli
+  //! trials it would save at pDeath = 0.4.
+  class geometric_gap
+  {
+  public:
+    //! \param p success probability, 0 < p < 1
+    explicit geometric_gap(double p) : scale_(std::max(1.0 / std::log1p(-p), std::numeric_limits<double>::lowest())) {}
+
+    //! \brief Draws n <= sample_batch independent gaps
+    //!
+    //! The logarithms do not depend on each other, thus they
+    //! overlap, unlike one variate per call. Gaps are capped at
+    //! SIZE_MAX / 2, beyond any range the callers sweep; for tiny p
+    //! the variate may exceed 2^64.
+    template <typename URNG>
+    void operator()(URNG& reng, size_t* out, size_t n) const
+    {
+      double u[sample_batch];
+      for (size_t i = 0; i < n; ++i)
+      {
+        u[i] = uniform53(reng);
+      }
+#pragma omp simd
+      for (size_t i = 0; i < n; ++i)
+      {
+        u[i] = std::log(u[i]) * scale_;
+      }
+      constexpr double most = static_cast<double>(SIZE_MAX / 2);
+      for (size_t i = 0; i < n; ++i)
+      {
+        out[i] = static_cast<size_t>(u[i] < most ? u[i] : most);
+      }
+    }
+
+  private:
+    double scale_;
+  };
+
+
+  //! \brief Draws n <= sample_batch Cauchy deviates
+  //!
+  //! Inversion, the tangents vectorize.
+  template <typename URNG>
+  void draw_deviates(std::cauchy_distribution<> const& dist, URNG& reng, double* out, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+    {
+      out[i] = uniform53(reng);
+    }
+    const double a = dist.a();
+    const double b = dist.b();
+#pragma omp simd
+    for (size_t i = 0; i < n; ++i)
+    {
+      out[i] = a + b * std::tan(3.141592653589793 * (out[i] - 0.5));
+    }
+  }
+
+
+  //! \brief Draws n <= sample_batch normal deviates
+  //!
+  //! Box-Muller, two deviates from two uniforms,
+  //! the transcendentals vectorize.
+  template <typename URNG>
+  void draw_deviates(std::normal_distribution<> const& dist, URNG& reng, double* out, size_t n)
+  {
+    const size_t pairs = (n + 1) / 2;
+    double u[sample_batch / 2], v[sample_batch / 2];
+    for (size_t i = 0; i < pairs; ++i)
+    {
+      u[i] = uniform53(reng);
+      v[i] = uniform53(reng);
+    }
+    const double mean = dist.mean();
+    const double sd = dist.stddev();
+#pragma omp simd
+    for (size_t i = 0; i < pairs; ++i)
+    {
+      const double r = sd * std::sqrt(-2.0 * std::log(u[i]));
+      u[i] = mean + r * std::cos(6.283185307179586 * v[i]);
+      v[i] = mean + r * std::sin(6.283185307179586 * v[i]);
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+      out[i] = (i & 1) ? v[i / 2] : u[i / 2];
+    }
+  }
+
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+/*! \file survival.h
+* \brief Mortality sweep with geometric skip sampling
+*
+*/
+
+#ifndef NPM_SURVIVAL_H_INCLUDED
+#define NPM_SURVIVAL_H_INCLUDED
+
+#include <cstddef>
+#include <algorithm>
+#include "sampling.h"
+
+
+namespace npm {
+
+
+  //! \brief Removes the dead from a range in a single pass
+  //! \param first begin of the individuals
+  //! \param last end of the individuals
+  //! \param pDeath death probability of the non-exempt
+  //! \param exempt exempt(x) survives for sure
+  //! \param reng random number engine
+  //! \returns the new end, the survivors keep their order
+  //!
+  //! Same distribution as one Bernoulli trial per individual, but
+  //! draws only the gaps between the rarer outcome: between the
+  //! deaths if pDeath <= 0.5, between the survivors otherwise.
+  //! Takes about min(pDeath, 1 - pDeath) * n geometric variates,
+  //! drawn in batches sized to the expected number of rare outcomes.
+  template <typename It, typename EXEMPT, typename URNG>
+  It survival_sweep(It first, It last, double pDeath, EXEMPT exempt, URNG& reng)
+  {
+    if (pDeath <= 0.0 || first == last) return last;
+    const bool rare_death = pDeath <= 0.5;
+    const double p = rare_death ? pDeath : 1.0 - pDeath;
+    It out = first;
+    if (p <= 0.0)
+    { // nobody but the exempt survives
+      for (; first != last; ++first)
+      {
+        if (exempt(*first)) *out++ = *first;
+      }
+      return out;
+    }
+    const geometric_gap gap_dist(p);
+    size_t gaps[sample_batch];
+    size_t ng = 0, ig = 0;
+    auto refill = [&]()
+    {
+      const double expected = p * static_cast<double>(last - first);
+      ng = std::min(sample_batch, static_cast<size_t>(expected) + 1);
+      gap_dist(reng, gaps, ng);
+      ig = 0;
+    };
+    refill();
+    size_t gap = gaps[ig++];              // trials to the next rare outcome
+    for (; first != last; ++first)
+    {
+      const bool ex = exempt(*first);
+      const bool rare = !ex && (gap == 0);
+      if (rare)
+      {
+        if (ig == ng) refill();
+        gap = gaps[ig++];
+      }
+      else
+      {
+        gap -= !ex;
+      }
+      *out = *first;
+      out += ex || (rare != rare_death);
+    }
+    return out;
+  }
+
+
+}
+
+#endif
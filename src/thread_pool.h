@@ -0,0 +1,233 @@
+/*! \file thread_pool.h
+* \brief Minimal fork-join thread pool
+*
+*/
+
+#ifndef NPM_THREAD_POOL_H_INCLUDED
+#define NPM_THREAD_POOL_H_INCLUDED
+
+#include <cstddef>
+#include <vector>
+#include <numeric>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <exception>
+
+
+namespace npm {
+
+
+  //! \brief Statistics of a work-stealing run
+  struct steal_stats
+  {
+    size_t steals;        //!< number of stolen tasks
+    double imbalance;     //!< max over mean busy time of the threads
+  };
+
+
+  //! \brief A fork-join thread pool
+  //!
+  //! The calling thread takes part in the work, thus
+  //! a pool of \p N threads spawns \p N - 1 workers.
+  class thread_pool
+  {
+  public:
+    //! \brief creates the pool
+    //! \param num_threads number of threads including the calling thread
+    explicit thread_pool(size_t num_threads)
+    : num_threads_(num_threads ? num_threads : 1),
+      queues_(new task_queue[num_threads ? num_threads : 1])
+    {
+      for (size_t i = 1; i < num_threads_; ++i)
+      {
+        workers_.emplace_back([this]() { worker_loop(); });
+      }
+    }
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool& operator=(thread_pool const&) = delete;
+
+    ~thread_pool()
+    {
+      {
+        std::lock_guard<std::mutex> _(mutex_);
+        stop_ = true;
+      }
+      cv_start_.notify_all();
+      for (auto& w : workers_) w.join();
+    }
+
+    //! Returns number of threads including the calling thread
+    size_t num_threads() const { return num_threads_; }
+
+    //! \brief Runs fun(i) for i in [0, n)
+    //! \param n number of tasks
+    //! \param fun a function object with the signature void fun(size_t);
+    //!
+    //! Blocks until all tasks are done. The first exception thrown
+    //! by any task is rethrown in the calling thread.
+    template <typename Fun>
+    void parallel_for(size_t n, Fun&& fun)
+    {
+      if (n == 0) return;
+      if (workers_.empty() || n == 1)
+      {
+        for (size_t i = 0; i < n; ++i) fun(i);
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> _(mutex_);
+        task_ = std::ref(fun);
+        n_ = n;
+        next_.store(0);
+        busy_ = workers_.size();
+        ++generation_;
+      }
+      cv_start_.notify_all();
+      run_tasks();
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_done_.wait(lock, [this]() { return busy_ == 0; });
+      task_ = nullptr;
+      if (exception_)
+      {
+        auto e = exception_;
+        exception_ = nullptr;
+        std::rethrow_exception(e);
+      }
+    }
+
+    //! \brief Runs fun(i) for i in [0, n) with work-stealing
+    //! \param n number of tasks
+    //! \param fun a function object with the signature void fun(size_t);
+    //! \returns steal count and load imbalance of this run
+    //!
+    //! Every thread starts with a contiguous range of the tasks and
+    //! processes it from the front. Idle threads steal from the back
+    //! of the other ranges. Blocks until all tasks are done.
+    template <typename Fun>
+    steal_stats parallel_for_stealing(size_t n, Fun&& fun)
+    {
+      const size_t T = num_threads_;
+      for (size_t t = 0; t < T; ++t)
+      {
+        queues_[t].head = t * n / T;
+        queues_[t].tail = (t + 1) * n / T;
+      }
+      std::vector<double> busy(T, 0.0);
+      std::atomic<size_t> steals{ 0 };
+      parallel_for(T, [&](size_t t)
+      {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        size_t stolen = 0;
+        size_t task;
+        for (;;)
+        {
+          if (!queues_[t].pop_front(task))
+          {
+            if (!steal(t, task)) break;
+            ++stolen;
+          }
+          fun(task);
+        }
+        busy[t] = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t0).count();
+        steals += stolen;
+      });
+      const double mean = std::accumulate(busy.cbegin(), busy.cend(), 0.0) / T;
+      const double max = *std::max_element(busy.cbegin(), busy.cend());
+      return { steals.load(), (mean > 0.0) ? max / mean : 1.0 };
+    }
+
+  private:
+    // range of task indices owned by one thread
+    struct task_queue
+    {
+      bool pop_front(size_t& task)
+      {
+        std::lock_guard<std::mutex> _(mutex);
+        if (head == tail) return false;
+        task = head++;
+        return true;
+      }
+
+      bool pop_back(size_t& task)
+      {
+        std::lock_guard<std::mutex> _(mutex);
+        if (head == tail) return false;
+        task = --tail;
+        return true;
+      }
+
+      std::mutex mutex;
+      size_t head = 0;
+      size_t tail = 0;
+    };
+
+    bool steal(size_t thief, size_t& task)
+    {
+      for (size_t i = 1; i < num_threads_; ++i)
+      {
+        if (queues_[(thief + i) % num_threads_].pop_back(task)) return true;
+      }
+      return false;
+    }
+
+    void run_tasks()
+    {
+      for (size_t i = next_++; i < n_; i = next_++)
+      {
+        try
+        {
+          task_(i);
+        }
+        catch (...)
+        {
+          std::lock_guard<std::mutex> _(mutex_);
+          if (!exception_) exception_ = std::current_exception();
+        }
+      }
+    }
+
+    void worker_loop()
+    {
+      size_t seen = 0;
+      for (;;)
+      {
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          cv_start_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+          if (stop_) return;
+          seen = generation_;
+        }
+        run_tasks();
+        {
+          std::lock_guard<std::mutex> _(mutex_);
+          if (--busy_ == 0) cv_done_.notify_one();
+        }
+      }
+    }
+
+    size_t num_threads_;
+    std::unique_ptr<task_queue[]> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable cv_start_;
+    std::condition_variable cv_done_;
+    std::function<void(size_t)> task_;
+    std::atomic<size_t> next_{ 0 };
+    size_t n_ = 0;
+    size_t busy_ = 0;
+    size_t generation_ = 0;
+    bool stop_ = false;
+    std::exception_ptr exception_;
+  };
+
+
+}
+
+#endif
@@ -0,0 +1,103 @@
+/*! \file validate_bernoulli.cpp
+* \brief Statistical equivalence of the threshold Bernoulli trials
+*
+* Draws rndutils::bernoulli_trial and rndutils::generate_bernoulli_n
+* from RndEng over a grid of probabilities and reports the z-score of
+* the success count, and counts the decisions that differ from
+* std::bernoulli_distribution on a copy of the same engine state.
+* Fails if a z-score exceeds the bound, if p = 0 or p = 1 is not
+* exact, or if a decision differs.
+* Usage: validate_bernoulli [trials [bound]]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include "npm.h"
+
+
+namespace npm {
+
+  rnd_engine thread_local RndEng = rndutils::make_random_engine<rnd_engine>();
+
+}
+
+
+using namespace npm;
+
+
+namespace {
+
+  // z-score of k successes in n trials, exact match required for p in {0, 1}
+  double zscore(size_t k, size_t n, double p)
+  {
+    const double mean = static_cast<double>(n) * p;
+    const double var = mean * (1.0 - p);
+    if (var == 0.0) return (static_cast<double>(k) == mean) ? 0.0 : INFINITY;
+    return (static_cast<double>(k) - mean) / std::sqrt(var);
+  }
+
+
+  size_t count_trial(size_t n, double p)
+  {
+    const auto thr = rndutils::bernoulli_threshold(p);
+    size_t k = 0;
+    for (size_t i = 0; i < n; ++i) k += rndutils::bernoulli_trial(RndEng, thr);
+    return k;
+  }
+
+
+  size_t count_batch(size_t n, double p)
+  {
+    constexpr size_t batch = 1000;
+    std::vector<uint64_t> thr(batch);
+    std::vector<char> out(batch);
+    size_t k = 0;
+    for (size_t i = 0; i < n; i += batch) {
+      const size_t m = std::min(batch, n - i);
+      std::fill_n(thr.begin(), m, rndutils::bernoulli_threshold(p));
+      rndutils::generate_bernoulli_n(m, thr.data(), RndEng, out.data());
+      for (size_t j = 0; j < m; ++j) k += out[j];
+    }
+    return k;
+  }
+
+
+  // decisions differing from std::bernoulli_distribution on the same engine state
+  size_t count_differ(size_t n, double p)
+  {
+    auto a = RndEng;
+    auto b = RndEng;
+    std::bernoulli_distribution dist(p);
+    const auto thr = rndutils::bernoulli_threshold(p);
+    size_t d = 0;
+    for (size_t i = 0; i < n; ++i) d += (dist(a) != rndutils::bernoulli_trial(b, thr));
+    RndEng = a;
+    return d;
+  }
+
+}
+
+
+int main(int argc, const char* argv[])
+{
+  const size_t trials = (argc > 1) ? static_cast<size_t>(std::stod(argv[1])) : size_t(1e7);
+  const double bound = (argc > 2) ? std::stod(argv[2]) : 5.0;
+  bool ok = true;
+  std::cout << std::setw(10) << "p" << std::setw(12) << "z trial" << std::setw(12) << "z batch" << std::setw(10) << "differ\n";
+  for (double p : { 0.0, 1e-6, 0.01, 0.3, 0.5, 0.97, 1.0 }) {
+    const double zt = zscore(count_trial(trials, p), trials, p);
+    const double zb = zscore(count_batch(trials, p), trials, p);
+    const size_t d = count_differ(trials, p);
+    const bool pass = std::abs(zt) <= bound && std::abs(zb) <= bound && d == 0;
+    std::cout << std::setw(10) << std::defaultfloat << p
+              << std::fixed << std::setprecision(2) << std::setw(12) << zt << std::setw(12) << zb
+              << std::setw(9) << d << "  " << (pass ? "ok" : "FAIL") << '\n';
+    ok = ok && pass;
+  }
+  std::cout << "bernoulli " << trials << " trials, |z| <= " << bound << ": " << (ok ? "passed" : "failed") << '\n';
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+/*! \file validate_math.cpp
+* \brief Error budget of math=fast
+*
+* Evaluates the survival, fecundity and logistic functions of the
+* model in math=exact and math=fast over a parameter grid and
+* reports the largest absolute and relative deviation. Fails if an
+* absolute probability error exceeds the budget.
+* Usage: math_budget [budget]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+#include "isa.h"
+#include "logistic.h"
+#include "math_mode.h"
+
+
+namespace npm {
+
+  rnd_engine thread_local RndEng = rndutils::make_random_engine<rnd_engine>();
+
+}
+
+
+using namespace npm;
+
+
+namespace {
+
+  // largest deviation, worst at the largest absolute
+  // deviation of probabilities, at the largest relative else
+  struct error_stat
+  {
+    explicit error_stat(bool probability = true) : probability(probability) {}
+
+    void operator()(double exact, double fast, std::string const& at)
+    {
+      const double a = std::abs(fast - exact);
+      const double r = exact != 0.0 ? a / std::abs(exact) : a;
+      if (probability ? a > abs : r > rel) where = at;
+      abs = std::max(abs, a);
+      rel = std::max(rel, r);
+    }
+
+    bool probability;
+    double abs = 0.0;
+    double rel = 0.0;
+    std::string where;
+  };
+
+
+  bool report(std::string const& name, error_stat const& e, double budget)
+  {
+    const bool ok = !e.probability || e.abs <= budget;
+    std::cout << std::setw(22) << std::left << name << std::right
+              << std::scientific << std::setprecision(2) << std::setw(12);
+    if (e.probability) std::cout << e.abs;    // absolute error only for probabilities
+    else std::cout << "";
+    std::cout << std::setw(12) << e.rel
+              << "  " << (ok ? "ok  " : "FAIL") << "  " << e.where << '\n';
+    return ok;
+  }
+
+
+  std::string at(std::initializer_list<std::pair<const char*, double>> args)
+  {
+    std::ostringstream os;
+    for (auto const& a : args) os << a.first << '=' << a.second << ' ';
+    return os.str();
+  }
+
+}
+
+
+int main(int argc, const char* argv[])
+{
+  const double budget = (argc > 1) ? std::stod(argv[1]) : 1e-8;
+  bool ok = true;
+  std::cout << "function                 max abs     max rel        worst at\n";
+
+  // exp over the argument range of the reaction norms
+  error_stat e_exp(false);
+  for (double x = -50.0; x <= 50.0; x += 1e-4)
+  {
+    e_exp(std::exp(x), fast_exp(x), at({{"x", x}}));
+  }
+  report("exp", e_exp, budget);
+
+  // logistic x(n,R), y(n,R), every kernel variant the CPU supports
+  for (int isa = 0; isa <= detect_isa(); ++isa)
+  {
+    select_isa(static_cast<Isa>(isa));
+    logistic_batch batch;
+    std::vector<double> pe, pf;
+    error_stat e_logistic;
+    for (double n = 1.0; n <= 100.0; n += 1.0)
+    {
+      batch.c0.clear(); batch.c1.clear(); batch.c2.clear(); batch.R.clear();
+      for (double c0 = -10.0; c0 <= 10.0; c0 += 0.5)
+      {
+        for (double c = -2.0; c <= 2.0; c += 0.25)
+        {
+          batch.c0.push_back(c0);
+          batch.c1.push_back(c);
+          batch.c2.push_back(-c);
+          batch.R.push_back(std::floor(n / 2.0) + 1.0);
+        }
+      }
+      pe.resize(batch.size());
+      pf.resize(batch.size());
+      logistic(batch, n, MATH_EXACT, pe.data());
+      logistic(batch, n, MATH_FAST, pf.data());
+      for (size_t i = 0; i < batch.size(); ++i)
+      {
+        e_logistic(pe[i], pf[i], at({{"n", n}, {"c0", batch.c0[i]}, {"c1", batch.c1[i]}}));
+      }
+    }
+    ok &= report(std::string("logistic ") + isa_name[isa], e_logistic, budget);
+  }
+
+  // survival S(n), Patch::do_survival
+  error_stat e_survival;
+  Parameter param;
+  for (double sigma : { 0.01, 0.1, 1.0, 5.0 })
+  {
+    param.sigma = sigma;
+    const double theta = param.thetaB();
+    for (double n = 1.0; n <= 200.0; n += 1.0)
+    {
+      e_survival(theta + (param.Smax - theta) * (1.0 - math_exp(-sigma * n, MATH_EXACT)),
+                 theta + (param.Smax - theta) * (1.0 - math_exp(-sigma * n, MATH_FAST)),
+                 at({{"sigma", sigma}, {"n", n}}));
+    }
+  }
+  ok &= report("survival", e_survival, budget);
+
+  // fecundity F(n,R) / F0, Patch's fecundity
+  error_stat e_fecundity;
+  for (double k : { 0.01, 0.1, 1.0, 10.0 })
+  {
+    for (double delta : { 0.0, 0.1, 0.5, 1.0, 2.0 })
+    {
+      for (double n = 1.0; n <= 100.0; n += 1.0)
+      {
+        for (double R = 1.0; R <= n; R += 1.0)
+        {
+          e_fecundity((1.0 - math_exp(-k * n, MATH_EXACT)) * rank_power(R, delta, MATH_EXACT),
+                      (1.0 - math_exp(-k * n, MATH_FAST)) * rank_power(R, delta, MATH_FAST),
+                      at({{"k", k}, {"delta", delta}, {"n", n}, {"R", R}}));
+        }
+      }
+    }
+  }
+  ok &= report("fecundity", e_fecundity, budget);
+
+  std::cout << "budget " << std::scientific << std::setprecision(2) << budget << ": " << (ok ? "passed\n" : "failed\n");
+  return ok ? 0 : 1;
+}
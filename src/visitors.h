@@ -30,9 +30,14 @@ namespace npm{
   public:
     collect_xynR_visitor() {}
 
-    void operator()(Patch const& patch)
+    //! collects the polls of the patches that are still occupied
+    void operator()(verdict_table const& verdicts, std::vector<Patch> const& patches)
     {
-      v_.insert(v_.end(), patch.verdict().begin(), patch.verdict().end());
+      for (auto const& poll : verdicts.polls)
+      {
+        if (patches[poll.patch].empty()) continue;
+        v_.insert(v_.end(), verdicts.xynR.begin() + poll.first, verdicts.xynR.begin() + poll.last);
+      }
     }
     std::vector<xynR_type> v_;
   };
@@ -48,7 +53,7 @@ namespace npm{
     {
       v_.push_back(x.mRank);
     }
-    std::vector<unsigned> v_;
+    std::vector<rank_t> v_;
   };
 
 
@@ -89,17 +94,17 @@ namespace npm{
       ++counts_;
     }
     
-    Alleles mean() const
+    std::array<double, MAX_ALLELE> mean() const
     {
       if (counts_ == 0) return alleles_;
-      Alleles tmp(alleles_);
+      auto tmp(alleles_);
       for (size_t i = 0; i < Loci::MAX_ALLELE; ++i) tmp[i] /= counts_;
       return tmp;
     }
 
   private:
     size_t counts_;
-    Alleles alleles_;
+    std::array<double, MAX_ALLELE> alleles_;    // double even for float alleles
   };
 
 
@@ -121,11 +126,13 @@ namespace npm{
     {
     }
 
-    void operator()(Patch const& patch)
+    //! takes the polls of the patches that are still occupied
+    void operator()(verdict_table const& verdicts, std::vector<Patch> const& patches)
     {
-      if (!patch.verdict().empty()) 
+      for (auto const& poll : verdicts.polls) 
       { 
-        auto xynR = patch.verdict()[0]; 
+        if (patches[poll.patch].empty()) continue;
+        auto xynR = verdicts.xynR[poll.first]; 
         if (c_ == 0) 
         {
           sum_ = xynR; 